@@ -10,6 +10,7 @@
 #include <vector>
 #include <boost/dynamic_bitset.hpp>
 #include "itemtype.hpp"
+#include "momentstore.hpp"
 
 using IntIterator = std::vector<int>::iterator;
 using BitSet = boost::dynamic_bitset<uintptr_t>;
@@ -20,11 +21,16 @@ namespace timeplane {
 class Moment;
 
 using MomentIterators = std::pair<
-                        std::vector<Moment>::const_iterator,
-                        std::vector<Moment>::const_iterator>;
+                        MomentStore::const_iterator,
+                        MomentStore::const_iterator>;
 using MomentDeleterFn = std::function<void (typename MomentIterators)>;
 }
 
+namespace roundinfo {
+// A set of players, where each bit is indexed by a player ID
+using PlayerMask = std::uint32_t;
+}
+
 namespace item {
 class Item;
 
@@ -5,8 +5,9 @@
 
 using namespace item;
 
-Antitelephone::Antitelephone(Moment first_moment)
-    :Item{first_moment, FirstProperties()} {}
+Antitelephone::Antitelephone(
+    Moment first_moment, ItemStateTable* table, int column)
+    :Item{first_moment, FirstProperties(), table, column} {}
 
 ItemProperties Antitelephone::FirstProperties() noexcept {
     ItemProperties result{};
@@ -41,15 +42,14 @@ std::pair<Effect, ItemProperties> Antitelephone::BranchImpl(
     return result;
 }
 
-TaggedValues Antitelephone::StateTaggedValues(Moment m) const {
+StateTags Antitelephone::State(Moment m) const {
     ItemProperties const& properties = GetProperties(m);
-    TaggedValues result;
+    StateTags result;
     int lockdown = properties.lockdown();
     if (lockdown > 0) {
-        result.emplace_back("energy_debt", std::to_string(lockdown));
+        result.Add(StateTag::kEnergyDebt, lockdown);
     } else {
-        result.emplace_back("activation_energy",
-                            std::to_string(properties.cooldown() + 1));
+        result.Add(StateTag::kActivationEnergy, properties.cooldown() + 1);
     }
     return result;
 }
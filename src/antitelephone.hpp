@@ -9,7 +9,7 @@ namespace item {
 /**
  * @brief Item which allows traveling to the past.
  */
-class Antitelephone : public Item {
+class Antitelephone final : public Item {
   public:
     /**
      * @brief An enum representation of the type of the item.
@@ -19,11 +19,12 @@ class Antitelephone : public Item {
      */
     static ItemType constexpr type = ItemType::kAntitelephone;
 
-    Antitelephone(Moment first_moment);
+    Antitelephone(Moment first_moment, ItemStateTable* table = nullptr,
+                  int column = 0);
 
     Effect View(Moment) const;
 
-    TaggedValues StateTaggedValues(Moment m) const;
+    StateTags State(Moment m) const;
 
   protected:
     std::pair<Effect, ItemProperties> StepImpl(Moment curr,
@@ -33,6 +34,8 @@ class Antitelephone : public Item {
         Moment curr, Moment dest);
 
   private:
+    friend class ItemSet;
+
     // Initial set of properties for the item.
     static ItemProperties FirstProperties() noexcept;
 };
@@ -1,19 +1,29 @@
 #include <algorithm>
 #include <cassert>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <random>
 #include <boost/optional.hpp>
 #include "pcg_random.hpp"
 
 #include "moment.hpp"
+#include "sharedmomentmap.hpp"
+#include "spillfile.hpp"
+#include "tieredmomentmap.hpp"
 #include "timeplane.hpp"
 
+#include "divergenceindex.hpp"
+#include "playerhistory.hpp"
 #include "roundinfo.hpp"
 #include "roundinfoview.hpp"
 
-#include "itemsutil.hpp"
+#include "itemset.hpp"
 #include "queryresult.hpp"
 
+#include "gamesnapshot.hpp"
+#include "memoryreport.hpp"
+#include "momentfeed.hpp"
 #include "momentoverview.hpp"
 #include "movedata.hpp"
 
@@ -30,14 +40,52 @@ using namespace external;
 #define AG_ AntitelephoneGame
 #define AI_ AntitelephoneGame::Impl
 
+namespace {
+/* The state of every item at a moment, so that traveling to the moment
+ * restores every player without querying each item. The properties stay
+ * in the pool of the item state table, and only their handles are kept. */
+struct Keyframe {
+    // The handles of every item, indexed by player and then by item
+    ItemStateTable::Handles handles;
+    // The combined effects of the items of each player
+    std::vector<Effect> effects;
+
+    template<typename Archive>
+    void serialize(Archive& ar, unsigned int const version) {
+        (void)version;
+        assert(version == 0);
+        ar & handles & effects;
+    }
+};
+}
+
 class AntitelephoneGame::Impl {
   public:
-    Impl(int game_id, int num_players, uint64_t random_seed);
+    Impl(int game_id, int num_players, uint64_t random_seed,
+         bool retain_all_timelines, bool defer_cleanup, int spill_horizon,
+         bool publish_snapshots);
 
     TimePlane const& time_plane() const noexcept {
         return timeplane_;
     }
 
+    PlayerHistory const& player_history() const noexcept {
+        return history_;
+    }
+
+    DivergenceIndex const& divergence_index() const noexcept {
+        return divergence_;
+    }
+
+    MomentFeed const& moment_feed() const noexcept {
+        return feed_;
+    }
+
+    std::shared_ptr<GameSnapshot const> snapshot() const {
+        std::lock_guard<std::mutex> lock{snapshot_mutex_};
+        return snapshot_;
+    }
+
     AG_::MomentOverviewQueryResult GetOverview(int player, Moment m) const;
 
     QueryResult MakeRegularMove(int player, MoveData&& move);
@@ -51,6 +99,10 @@ class AntitelephoneGame::Impl {
 
     void RegisterEndGameHandler(AG_::EndGameHandler&& handler);
 
+    void Collect();
+
+    MemoryReport memory_report() const;
+
     Impl(Impl const&) = delete;
     Impl& operator=(Impl const&) = delete;
     Impl(Impl&&) = delete;
@@ -58,6 +110,11 @@ class AntitelephoneGame::Impl {
 
   private:
     static int constexpr kNoAntiplayer = -1;
+    // Keyframes are captured at every multiple of this time
+    static int constexpr kKeyframeInterval = 8;
+    // Data is spilled once the horizon is exceeded by this fraction of it,
+    // to amortize scanning for the data to spill
+    static int constexpr kSpillBatchDivisor = 4;
 
     int game_id_;
     int num_players_;
@@ -66,11 +123,37 @@ class AntitelephoneGame::Impl {
     AG_::TravelHandler travel_handler_;
     AG_::EndGameHandler end_game_handler_;
     TimePlane timeplane_;
-    std::unordered_map<Moment, RoundInfo> round_info_;
-    std::unordered_map<Moment, std::unordered_map<int, MoveData>> moves_info_;
-    std::vector<ItemArr> items_;
+    // Declared before any data that may be spilled into it
+    // Shared with the snapshots that read spilled records back
+    std::shared_ptr<SpillFile> spill_file_;
+    // Shared with the snapshots, so every moment's information is stored
+    // once
+    SharedMomentMap<RoundInfo> round_info_;
+    TieredMomentMap<std::unordered_map<int, MoveData>> moves_info_;
+    TieredMomentMap<Keyframe> keyframes_;
+    PlayerHistory history_;
+    // Only recorded if snapshots are published
+    SharedMomentMap<GameSnapshot::MomentRecord> snapshot_records_;
+    // Only guards the pointer, so readers never wait on a round
+    mutable std::mutex snapshot_mutex_;
+    std::shared_ptr<GameSnapshot const> snapshot_;
+    MomentFeed feed_;
+    // Declared before the items that store their properties in it
+    ItemStateTable item_states_;
+    std::vector<ItemSet> items_;
     std::unordered_map<int, MoveData> moves_pending_;
+    DivergenceIndex divergence_;
     int antiplayer_;
+    // The epoch up to which data of retired moments has been reclaimed
+    int reclaimed_epoch_;
+    int num_reclaimed_;
+    int num_pruned_;
+    // Moves before this time in the first timeline have been pruned
+    int moves_pruned_until_;
+    int spill_horizon_;
+    // The data of moments before this time has been spilled
+    int spilled_until_;
+    bool publish_snapshots_;
     bool game_over;
 
     inline int NumLocations();
@@ -79,17 +162,54 @@ class AntitelephoneGame::Impl {
 
     void ProcessMoves();
 
-    void MomentDeleter(MomentIterators m);
+    void ReclaimMoments();
+
+    int EarliestReachableTime() const;
+
+    void PruneUnreachableMoves(Moment curr);
+
+    void SpillColdMoments(Moment latest);
+
+    void CaptureKeyframe(Moment m);
+
+    void RecordSnapshotMoment(Moment m);
+
+    void PublishSnapshot();
 };
 
-AI_::Impl(int game_id, int num_players, uint64_t random_seed)
+AI_::Impl(int game_id, int num_players, uint64_t random_seed,
+          bool retain_all_timelines, bool defer_cleanup, int spill_horizon,
+          bool publish_snapshots)
     :game_id_{game_id},
      num_players_{num_players},
      rand_{random_seed},
+     timeplane_{retain_all_timelines, defer_cleanup},
+     spill_file_{},
+     round_info_{},
+     history_{num_players},
+     snapshot_records_{},
+     snapshot_mutex_{},
+     snapshot_{},
+     feed_{kMomentFeedCapacity},
+     item_states_{num_players * ItemTypeCount},
      items_(),
+     divergence_{num_players},
      antiplayer_{kNoAntiplayer},
+     reclaimed_epoch_{0},
+     num_reclaimed_{0},
+     num_pruned_{0},
+     moves_pruned_until_{0},
+     spill_horizon_{spill_horizon},
+     spilled_until_{0},
+     publish_snapshots_{publish_snapshots},
      game_over{false} {
     assert(num_players >= kMinNumPlayers && num_players <= kMaxNumPlayers);
+    static_assert(kMaxNumPlayers <= MomentEvent::kMaxPlayers,
+                  "Every player must fit in the moment feed");
+    assert(spill_horizon >= 0 || spill_horizon == kNoSpillHorizon);
+    if (spill_horizon != kNoSpillHorizon) {
+        spill_file_ = std::make_shared<SpillFile>();
+    }
 
     // Obtain the first moment
     Moment first_moment = timeplane_.rightmost_timeline().LatestMoment();
@@ -104,54 +224,41 @@ AI_::Impl(int game_id, int num_players, uint64_t random_seed)
     IntIterator health_remaining_data =
         initial_info.HealthRemainingIterator();
     for (int i = 0; i < num_players; i++) {
-        items_.push_back(MakeItemPtrs(first_moment));
+        items_.emplace_back(first_moment, &item_states_, i);
         location_data[i] = RoundInfo::kUnknown;
         damage_received_data[i] = 0;
         health_remaining_data[i] = Item::kBasicMaxHitpoints / 2;
         initial_info.SetActive(i, true);
     }
-    round_info_.emplace(first_moment, std::move(initial_info));
-
-    // Register the moment deleter functions
-    timeplane_.RegisterMomentDeleter([this] (MomentIterators iter) {
-        this->MomentDeleter(iter);
-    });
-    for (ItemArr const& pitems: items_) {
-        for (ItemPtr const& item: pitems) {
-            timeplane_.RegisterMomentDeleter([&item] (MomentIterators iter) {
-                item->MomentDeleter(iter);
-            });
-        }
-    }
+    history_.Record(first_moment, initial_info);
+    RecordSnapshotMoment(first_moment);
+    feed_.Publish(MomentEvent::FromRoundInfo(first_moment, true,
+                                             initial_info));
+    round_info_.Append(first_moment, std::make_shared<RoundInfo const>(
+        std::move(initial_info)));
+    CaptureKeyframe(first_moment);
+    PublishSnapshot();
 }
 
 AG_::MomentOverviewQueryResult AI_::GetOverview(int player, Moment m) const {
 
-    auto finder = round_info_.find(m);
+    std::shared_ptr<RoundInfo const> info = round_info_.Find(m);
     int curr_timeline_no = timeplane_.rightmost_timeline()
                            .LatestMoment().parent_timeline_num();
     bool from_rightmost = (m.parent_timeline_num() == curr_timeline_no);
+    // Data may linger for moments that are awaiting clean up
     if (player < 0 || player >= num_players_ ||
             (!from_rightmost && player != antiplayer_) ||
-            finder == round_info_.cend()) {
+            info == nullptr || !timeplane_.IsAccessible(m)) {
         return std::make_pair(QueryResult{false, "bad_request"},
                               boost::none);
     }
 
-    RoundInfoView view{finder->second, player, !from_rightmost};
-    ItemArr const& pitems = items_[player];
-
-    MomentOverview::TaggedValuesArr item_state_data;
-    Effect effect{};
-
-    for (int i = 0; i < ItemTypeCount; i++) {
-        ItemPtr const& item = pitems[i];
-        effect += item->View(m);
-        item_state_data[i] = item->StateTaggedValues(m);
-    }
+    RoundInfoView view{*info, player, !from_rightmost};
+    ItemSet const& pitems = items_[player];
 
     return std::make_pair(QueryResult{}, MomentOverview{
-        m, effect, std::move(item_state_data), std::move(view)});
+        m, pitems.View(m), pitems.State(m), std::move(view)});
 }
 
 int AI_::NumLocations() {
@@ -198,11 +305,10 @@ QueryResult AI_::MakeRegularMove(int player, MoveData&& move) {
         return result;
     }
 
-    MoveData* move_to_use = &move;
+    MoveData const* move_to_use = &move;
     TimeLine const& timeline = timeplane_.rightmost_timeline();
     Moment curr = timeline.LatestMoment();
-    RoundInfo const& curr_info = round_info_.at(curr);
-    if (!curr_info.Active(player)) {
+    if (!round_info_.at(curr)->Active(player)) {
         TimeLine const& timeline_sec =
             timeplane_.second_rightmost_timeLine().get();
         move_to_use = &moves_info_.at(timeline_sec.GetMoment(curr.time()))
@@ -212,6 +318,7 @@ QueryResult AI_::MakeRegularMove(int player, MoveData&& move) {
     moves_pending_.emplace(player, *move_to_use);
     if (moves_pending_.size() == num_players_) {
         ProcessMoves();
+        PublishSnapshot();
     }
     return QueryResult{};
 }
@@ -229,51 +336,54 @@ QueryResult AI_::MakeAntitelephoneMove(int player, int dest_time) {
 
     // Determine whether Antitelephone is allowed
     Moment dest = timeline->GetMoment(dest_time);
-    Effect antiplayer_effect{};
-    ItemArr const& antiplayer_items = items_[player];
-    for (ItemPtr const& item: antiplayer_items) {
-        antiplayer_effect += item->Branch(curr, dest);
-    }
+    Effect antiplayer_effect = items_[player].Branch(curr, dest);
     if (dest_time > timeplane_.latest_antitelephone_arrival()
             && !antiplayer_effect.antitelephone_dest_allowed()) {
+        item_states_.Discard();
         return QueryResult{false, "antitelephone_prohibited"};
     }
 
     // Things to be incorporated into moment overviews
     std::vector<Effect> effects(num_players_);
     effects[player] = antiplayer_effect;
-    std::vector<MomentOverview::TaggedValuesArr> item_state_data;
+    std::vector<MomentOverview::StateTagsArr> item_state_data;
     item_state_data.reserve(num_players_);
 
     // This assumes that the second rightmost timeline is not
     // out of scope after this branch.
-    timeline = &timeplane_.MakeNewTimeLine(dest_time);
+    timeline = &timeplane_.MakeNewTimeLine(dest_time, player);
     Moment new_moment = timeline->LatestMoment();
 
-    // Update every player's item to the new moment
+    // Update every player's item to the new moment, restoring the state
+    // at the destination from a keyframe if there is one
+    Keyframe const* keyframe = keyframes_.Find(dest);
     for (int i = 0; i < num_players_; i++) {
-        ItemArr const& pitems = items_[i];
-        MomentOverview::TaggedValuesArr pitem_state_data;
-        for (int j = 0; j < ItemTypeCount; j++) {
-            ItemPtr const& item = pitems[i];
-            // The antitelephone player has already been dealt with
-            if (i != player) {
-                effects[i] += item->View(dest);
-                item->Duplicate(dest);
-            }
-            item->ConfirmPending(new_moment);
-            pitem_state_data[j] = item->StateTaggedValues(new_moment);
+        ItemSet& pitems = items_[i];
+        // The antitelephone player has already been dealt with
+        if (i != player && keyframe != nullptr) {
+            effects[i] += keyframe->effects[i];
+            pitems.Duplicate(keyframe->handles, i * ItemTypeCount);
+        } else if (i != player) {
+            effects[i] += pitems.View(dest);
+            pitems.Duplicate(dest);
         }
-        item_state_data.push_back(pitem_state_data);
+    }
+    item_states_.Commit(new_moment);
+    for (ItemSet const& pitems: items_) {
+        item_state_data.push_back(pitems.State(new_moment));
     }
 
     // Create a new set of round information
-    RoundInfo new_info{round_info_.at(dest)};
+    RoundInfo new_info{*round_info_.at(dest)};
     for (int i = 0; i < num_players_; i++) {
         new_info.SetActive(i, false);
     }
     new_info.SetActive(player, true);
-    round_info_.emplace(new_moment, new_info);
+    history_.Record(new_moment, new_info);
+    RecordSnapshotMoment(new_moment);
+    feed_.Publish(MomentEvent::FromRoundInfo(new_moment, true, new_info));
+    round_info_.Append(new_moment,
+                       std::make_shared<RoundInfo const>(new_info));
 
     // Create moment overviews and call the new round handler
     if (new_round_handler_) {
@@ -288,6 +398,13 @@ QueryResult AI_::MakeAntitelephoneMove(int player, int dest_time) {
     }
     moves_info_.emplace(curr, std::move(moves_pending_));
     moves_pending_ = std::unordered_map<int, MoveData>();
+    divergence_.Reset();
+    // Branch points are likely destinations for later travel
+    CaptureKeyframe(new_moment);
+    if (!timeplane_.defers_cleanup()) {
+        ReclaimMoments();
+    }
+    PublishSnapshot();
     return QueryResult{};
 }
 
@@ -303,7 +420,7 @@ void AI_::ProcessMoves() {
     assert(moves_pending_.size() == num_players_);
     TimeLine& timeline = timeplane_.rightmost_timeline();
     Moment curr = timeline.LatestMoment();
-    RoundInfo new_info{round_info_.at(curr)};
+    RoundInfo new_info{*round_info_.at(curr)};
 
     IntIterator location_data = new_info.LocationIterator();
     IntIterator damage_received = new_info.DamageReceivedIterator();
@@ -332,12 +449,10 @@ void AI_::ProcessMoves() {
     std::vector<Effect> effects = std::vector<Effect>(num_players_);
     // Also apply the healing effect from energy usage.
     for (int pid = 0; pid < num_players_; pid++) {
-        ItemArr const& pitems = items_[pid];
         MoveData const& pmove = moves_pending_.at(pid);
+        effects[pid] += items_[pid].View(curr);
         int used_energy = 0;
         for (int iid = 0; iid < ItemTypeCount; iid++) {
-            ItemPtr const& item = pitems[iid];
-            effects[pid] += item->View(curr);
             used_energy += pmove.EnergyInput(iid);
         }
         // Heal only if alive, and up to the maximum health.
@@ -354,7 +469,8 @@ void AI_::ProcessMoves() {
     int constexpr kNoEncounter = -1;
     std::vector<int> weakest_opponent =
         std::vector<int>(num_players_, kNoEncounter);
-    SymmetricBitMatrix encounters{num_players_};
+    // The set of players encountered by each player
+    std::vector<PlayerMask> encounters(num_players_, 0);
     for (int newp = 0; newp < num_players_; newp++) {
         if (health_remaining[newp] == 0) {
             // Dead players can't go anywhere
@@ -386,8 +502,9 @@ void AI_::ProcessMoves() {
                     }
                 }
 
-                // Add the encounter to the matrix
-                encounters.SetValue(newp, oldp, true);
+                // Add the encounter to both sets
+                encounters[newp] |= PlayerMask{1} << oldp;
+                encounters[oldp] |= PlayerMask{1} << newp;
             }
         }
     }
@@ -399,7 +516,8 @@ void AI_::ProcessMoves() {
         timeplane_.second_rightmost_timeLine();
     // The antiplayer might get an attack bonus if his opponent is inactive
     bool antiplayer_attack_bonus = false;
-    if (antiplayer_ != kNoAntiplayer) {
+    if (antiplayer_ != kNoAntiplayer &&
+            weakest_opponent[antiplayer_] != kNoEncounter) {
         antiplayer_attack_bonus =
             !new_info.Active(weakest_opponent[antiplayer_]);
     }
@@ -414,59 +532,54 @@ void AI_::ProcessMoves() {
     TimeLine const& timeline_sec = timeline_sec_opt.get();
     int new_time = curr.time() + 1;
 
-    // ***** if (second rightmost timeline is not relevant) {
-    if (timeline_sec.LatestMoment().time() < new_time) {
-        // Make all players active because the second rightmost
-        // timeline has already ended
-        for (int sleeper = 0; sleeper < num_players_; sleeper++) {
-            if (!new_info.Active(sleeper)) {
-                new_info.SetActive(sleeper, true);
-            }
+    // ***** if (second rightmost timeline is still replayed) {
+    if (timeline_sec.LatestMoment().time() >= new_time) {
+        // Read from the columnar history to avoid loading spilled moments
+        Moment const sec_moment = timeline_sec.GetMoment(new_time);
+        // Locations are offset so that the graveyard is the first index
+        int constexpr offset = -RoundInfo::kGraveyardLocation;
+        std::vector<PlayerMask> sec_at_location(NumLocations() + offset, 0);
+        for (int other = 0; other < num_players_; other++) {
+            sec_at_location[history_.Location(sec_moment, other) + offset] |=
+                PlayerMask{1} << other;
         }
-        goto timeline_sec_handling_end;
-    }
-
-    // ***** } else {
-    RoundInfo const& sec_info =
-        round_info_.at(timeline_sec.GetMoment(new_time));
-    int constexpr omnv = RoundInfo::kOmniscientViewer;
-
-    for (int other = 0; other < num_players_; other++) {
-        // Checking for equality of two boolean expressions.
-        // Just a heads up since it's slightly confusing.
-        if ((sec_info.Location(other, omnv) == location_data[antiplayer_])
-                != encounters.Value(antiplayer_, other)) {
-            // Encounter is different because a different
-            // set of players are taking part in it
-            antiplayer_attack_bonus = false;
-            break;
+        // The players each player would meet if nothing had changed, which
+        // like their encounters leaves out the player themself
+        std::vector<PlayerMask> expected(num_players_);
+        PlayerMask active = 0;
+        for (int pid = 0; pid < num_players_; pid++) {
+            expected[pid] = sec_at_location[location_data[pid] + offset] &
+                            ~(PlayerMask{1} << pid);
+            if (new_info.Active(pid)) {
+                active |= PlayerMask{1} << pid;
+            }
         }
-        if (encounters.Value(antiplayer_, other) && new_info.Active(other)) {
-            // Encounter is different because an active player
-            // is taking part in it
+        PlayerMask changed =
+            divergence_.Update(new_time, expected, encounters);
+
+        // The encounter is different if a different set of players are
+        // taking part in it, or if an active player is taking part in it.
+        // The pairwise comparison this replaced also treated the antiplayer
+        // as a different participant whenever they stayed where they were
+        // in the second-rightmost timeline, which is kept as is.
+        if ((changed & (PlayerMask{1} << antiplayer_)) ||
+                (encounters[antiplayer_] & active) ||
+                history_.Location(sec_moment, antiplayer_) ==
+                location_data[antiplayer_]) {
             antiplayer_attack_bonus = false;
-            break;
         }
     }
+    // ***** }
 
+    // Make all players active. Once the second rightmost timeline has
+    // ended there is nothing left to replay. Before that, the pairwise
+    // comparison the divergence index replaced counted every sleeper among
+    // the players at its own location in the second-rightmost timeline but
+    // never among its encounters, so it woke every sleeper every round.
+    // That behaviour is kept as is, so waking does not use the index.
     for (int sleeper = 0; sleeper < num_players_; sleeper++) {
-        if (new_info.Active(sleeper)) {
-            // No need to care about active players
-            continue;
-        }
-        int sleeper_location = location_data[sleeper];
-        // If the sleeper is in a different location across
-        // the timelines, then something has gone horribly wrong.
-        assert(sleeper_location == sec_info.Location(sleeper, omnv));
-
-        for (int other = 0; other < num_players_; other++) {
-            // Same comparison of boolean values
-            if ((sec_info.Location(other, omnv) == sleeper_location)
-                    != encounters.Value(sleeper, other)) {
-                // Either a missed encounter, or a new encounter with
-                // an active player involved.
-                new_info.SetActive(sleeper, true);
-            }
+        if (!new_info.Active(sleeper)) {
+            new_info.SetActive(sleeper, true);
         }
     }
 timeline_sec_handling_end:
@@ -508,15 +621,13 @@ timeline_sec_handling_end:
     std::vector<int> antiplayers; // Players who activated the antitelephone
     for (int pid = 0; pid < num_players_; pid++) {
         views.emplace_back(new_info, pid);
-        ItemArr const& pitems = items_[pid];
-        // Don't forget to zero out the effects first
-        effects[pid] = Effect{};
         MoveData const& pmove = moves_pending_.at(pid);
+        ItemSet::EnergyInputs energy_inputs;
         for (int iid = 0; iid < ItemTypeCount; iid++) {
-            ItemPtr const& item = pitems[iid];
-            effects[pid] += item->Step(curr, views[pid],
-                                       pmove.EnergyInput(iid));
+            energy_inputs[iid] = pmove.EnergyInput(iid);
         }
+        // This replaces the current effects
+        effects[pid] = items_[pid].Step(curr, views[pid], energy_inputs);
         // Any weird effects to deal with?
         if (effects[pid].antitelephone_departure()) {
             antiplayers.push_back(pid);
@@ -530,8 +641,9 @@ timeline_sec_handling_end:
     int num_antiplayers = static_cast<int>(antiplayers.size());
     if (num_antiplayers > 0) {
         // Who will be the true antitelephone player?
-        std::uniform_int_distribution<int> uniform(0, num_antiplayers);
+        std::uniform_int_distribution<int> uniform(0, num_antiplayers - 1);
         antiplayer_ = antiplayers[uniform(rand_)];
+        item_states_.Discard();
         if (travel_handler_) {
             travel_handler_(game_id_, antiplayer_);
         }
@@ -544,16 +656,11 @@ timeline_sec_handling_end:
     Moment new_moment = timeline.MakeMoment();
 
     // Now to finalize everything
-    std::vector<MomentOverview::TaggedValuesArr> item_state_data;
+    std::vector<MomentOverview::StateTagsArr> item_state_data;
     item_state_data.reserve(num_players_);
-    for (ItemArr const& pitems: items_) {
-        MomentOverview::TaggedValuesArr pitem_state_data;
-        for (int i = 0; i < ItemTypeCount; i++) {
-            ItemPtr const& item = pitems[i];
-            item->ConfirmPending(new_moment);
-            pitem_state_data[i] = item->StateTaggedValues(new_moment);
-        }
-        item_state_data.push_back(pitem_state_data);
+    item_states_.Commit(new_moment);
+    for (ItemSet const& pitems: items_) {
+        item_state_data.push_back(pitems.State(new_moment));
     }
 
     // Create moment overviews and call the new round handler
@@ -592,11 +699,20 @@ timeline_sec_handling_end:
     }
 
     // No turning back, moving lots of important data
-    round_info_.emplace(new_moment, std::move(new_info));
+    history_.Record(new_moment, new_info);
+    RecordSnapshotMoment(new_moment);
+    feed_.Publish(MomentEvent::FromRoundInfo(new_moment, false, new_info));
+    round_info_.Append(new_moment, std::make_shared<RoundInfo const>(
+        std::move(new_info)));
+    if (new_moment.time() % kKeyframeInterval == 0) {
+        CaptureKeyframe(new_moment);
+    }
 
     // Note, the moves are associated with curr, not the new moment
     moves_info_.emplace(curr, std::move(moves_pending_));
     moves_pending_ = std::unordered_map<int, MoveData>();
+    PruneUnreachableMoves(curr);
+    SpillColdMoments(new_moment);
 }
 
 void AI_::RegisterNewRoundHandler(NewRoundHandler&& handler) {
@@ -611,22 +727,203 @@ void AI_::RegisterEndGameHandler(EndGameHandler&& handler) {
     end_game_handler_ = handler;
 }
 
-void AI_::MomentDeleter(MomentIterators m) {
-    std::for_each(m.first, m.second,
-    [this] (Moment to_delete) {
-        this->round_info_.erase(to_delete);
-        this->moves_info_.erase(to_delete);
-    });
+/* A conservative lower bound on the time of any future antitelephone
+ * destination. Times up to the latest arrival are always allowed, so
+ * before any arrival only the items can allow a destination. */
+int AI_::EarliestReachableTime() const {
+    if (!timeplane_.arrivals().empty()) {
+        return 0;
+    }
+    Moment curr = timeplane_.rightmost_timeline().LatestMoment();
+    int result = curr.time();
+    for (ItemSet const& pitems: items_) {
+        result = std::min(result, pitems.EarliestDestination(curr));
+    }
+    return result;
+}
+
+/* Stored moves are only read to replay the moves of inactive players,
+ * which happens in the second rightmost timeline at the current time,
+ * and only from the destination of a branch onward. Once replayed, or
+ * once no branch can reach them, the moves are never read again. */
+void AI_::PruneUnreachableMoves(Moment curr) {
+    if (timeplane_.retains_all_timelines()) {
+        return;
+    }
+    boost::optional<TimeLine> const& timeline_sec_opt =
+        timeplane_.second_rightmost_timeLine();
+    if (timeline_sec_opt) {
+        // The moment is never shared with the rightmost timeline
+        TimeLine const& timeline_sec = timeline_sec_opt.get();
+        if (curr.time() <= timeline_sec.LatestMoment().time()) {
+            num_pruned_ +=
+                moves_info_.erase(timeline_sec.GetMoment(curr.time()));
+        }
+        return;
+    }
+    TimeLine const& timeline = timeplane_.rightmost_timeline();
+    int prune_until = std::min(EarliestReachableTime(), curr.time() + 1);
+    for (; moves_pruned_until_ < prune_until; moves_pruned_until_++) {
+        num_pruned_ +=
+            moves_info_.erase(timeline.GetMoment(moves_pruned_until_));
+    }
+}
+
+/* Only the latest moments of the rightmost timeline are read by every
+ * round, so older data is moved out of RAM. Anything older that is needed
+ * for time travel or an overview is read back from the file on demand. */
+void AI_::SpillColdMoments(Moment latest) {
+    if (!spill_file_) {
+        return;
+    }
+    int spill_until = latest.time() - spill_horizon_;
+    int batch = std::max(1, spill_horizon_ / kSpillBatchDivisor);
+    if (spill_until < spilled_until_ + batch) {
+        return;
+    }
+    round_info_.Spill(spill_file_, spill_until);
+    moves_info_.Spill(*spill_file_, spill_until);
+    keyframes_.Spill(*spill_file_, spill_until);
+    item_states_.Spill(*spill_file_, spill_until);
+    snapshot_records_.Spill(spill_file_, spill_until);
+    spilled_until_ = spill_until;
+}
+
+void AI_::CaptureKeyframe(Moment m) {
+    Keyframe keyframe{item_states_.HandlesAt(m), {}};
+    keyframe.effects.reserve(num_players_);
+    for (ItemSet const& pitems: items_) {
+        keyframe.effects.push_back(pitems.View(m));
+    }
+    keyframes_.emplace(m, std::move(keyframe));
+}
+
+void AI_::RecordSnapshotMoment(Moment m) {
+    if (!publish_snapshots_) {
+        return;
+    }
+    auto record = std::make_shared<GameSnapshot::MomentRecord>();
+    record->effects.reserve(num_players_);
+    record->item_state_data.reserve(num_players_);
+    for (ItemSet const& pitems: items_) {
+        record->effects.push_back(pitems.View(m));
+        record->item_state_data.push_back(pitems.State(m));
+    }
+    snapshot_records_.Append(m, std::move(record));
+}
+
+void AI_::PublishSnapshot() {
+    if (!publish_snapshots_) {
+        return;
+    }
+    TimeLine const& timeline = timeplane_.rightmost_timeline();
+    Moment latest = timeline.LatestMoment();
+    std::vector<TimeLine::Span> reachable =
+        timeline.GetMoments(0, latest.time() + 1);
+    auto const& timeline_sec = timeplane_.second_rightmost_timeLine();
+    if (timeline_sec) {
+        std::vector<TimeLine::Span> sec_reachable = timeline_sec->GetMoments(
+            0, timeline_sec->LatestMoment().time() + 1);
+        reachable.insert(reachable.end(), sec_reachable.begin(),
+                         sec_reachable.end());
+    }
+    // Every timeline left of the second rightmost one is either retained
+    // or inaccessible
+    int num_retained = timeplane_.retains_all_timelines() ?
+                       latest.parent_timeline_num() - 1 : 0;
+    // Only the data of the timelines the snapshot can reach is shared
+    std::vector<int> timeline_nums;
+    timeline_nums.reserve(num_retained + reachable.size());
+    for (int timeline_num = 0; timeline_num < num_retained; timeline_num++) {
+        timeline_nums.push_back(timeline_num);
+    }
+    for (TimeLine::Span const& span: reachable) {
+        timeline_nums.push_back(span.timeline_num);
+    }
+    auto snapshot = std::make_shared<GameSnapshot const>(
+        num_players_, antiplayer_, latest, std::move(reachable),
+        num_retained, round_info_.Share(timeline_nums),
+        snapshot_records_.Share(timeline_nums));
+    std::lock_guard<std::mutex> lock{snapshot_mutex_};
+    snapshot_ = std::move(snapshot);
+}
+
+void AI_::Collect() {
+    timeplane_.CollectDiscarded();
+    ReclaimMoments();
+    PublishSnapshot();
+}
+
+void AI_::ReclaimMoments() {
+    RetirementLog const& log = timeplane_.retirements();
+    if (reclaimed_epoch_ == log.epoch()) {
+        return;
+    }
+    num_reclaimed_ += round_info_.Reclaim(log, reclaimed_epoch_);
+    num_reclaimed_ += moves_info_.Reclaim(log, reclaimed_epoch_);
+    num_reclaimed_ += keyframes_.Reclaim(log, reclaimed_epoch_);
+    num_reclaimed_ += history_.Reclaim(log, reclaimed_epoch_);
+    snapshot_records_.Reclaim(log, reclaimed_epoch_);
+    num_reclaimed_ += item_states_.Reclaim(log, reclaimed_epoch_);
+    reclaimed_epoch_ = log.epoch();
+}
+
+MemoryReport AI_::memory_report() const {
+    MemoryReport result{};
+    result.segments = timeplane_.Segments();
+    result.num_live_moments = 0;
+    for (TimeLine::Segment const& segment: result.segments) {
+        result.num_live_moments += segment.num_moments;
+    }
+    result.round_info = round_info_.usage();
+    result.moves_info = moves_info_.usage();
+    result.keyframes = keyframes_.usage();
+    result.snapshot_records = snapshot_records_.usage();
+    result.player_history = StoreUsage{history_.size(), 0,
+                                       history_.memory_bytes()};
+    // Each node holds an entry and about two pointers
+    std::size_t node_bytes = sizeof(std::pair<int const, MoveData>) +
+                             2 * sizeof(void*);
+    result.moves_pending = StoreUsage{
+        static_cast<int>(moves_pending_.size()), 0,
+        moves_pending_.size() * node_bytes +
+        moves_pending_.bucket_count() * sizeof(void*)};
+    result.item_states = item_states_.usage();
+    result.num_retired = timeplane_.retirements().RetiredSince(0);
+    result.num_reclaimed = num_reclaimed_;
+    result.num_pruned = num_pruned_;
+    result.spill_file_bytes = spill_file_ ? spill_file_->size() : 0;
+    return result;
 }
 
 AG_::AntitelephoneGame(int game_id, int num_players,
-                       uint64_t random_seed)
-    :pimpl_{std::make_unique<Impl>(game_id, num_players, random_seed)} {}
+                       uint64_t random_seed, bool retain_all_timelines,
+                       bool defer_cleanup, int spill_horizon,
+                       bool publish_snapshots)
+    :pimpl_{std::make_unique<Impl>(game_id, num_players, random_seed,
+                                   retain_all_timelines, defer_cleanup,
+                                   spill_horizon, publish_snapshots)} {}
 
 TimePlane const& AG_::time_plane() const noexcept {
     return pimpl_->time_plane();
 }
 
+AG_::PlayerHistory const& AG_::player_history() const noexcept {
+    return pimpl_->player_history();
+}
+
+AG_::DivergenceIndex const& AG_::divergence_index() const noexcept {
+    return pimpl_->divergence_index();
+}
+
+MomentFeed const& AG_::moment_feed() const noexcept {
+    return pimpl_->moment_feed();
+}
+
+std::shared_ptr<AG_::GameSnapshot const> AG_::snapshot() const {
+    return pimpl_->snapshot();
+}
+
 AG_::MomentOverviewQueryResult AG_::GetOverview(int player, Moment m) const {
     return pimpl_->GetOverview(player, m);
 }
@@ -639,6 +936,14 @@ QueryResult AG_::MakeAntitelephoneMove(int player, int dest_time) {
     return pimpl_->MakeAntitelephoneMove(player, dest_time);
 }
 
+void AG_::Collect() {
+    pimpl_->Collect();
+}
+
+MemoryReport AG_::memory_report() const {
+    return pimpl_->memory_report();
+}
+
 void AG_::RegisterNewRoundHandler(NewRoundHandler handler) {
     pimpl_->RegisterNewRoundHandler(std::move(handler));
 }
@@ -11,9 +11,17 @@ class Moment;
 class TimePlane;
 }
 
+namespace roundinfo {
+class DivergenceIndex;
+class PlayerHistory;
+}
+
 namespace external {
+class GameSnapshot;
+class MomentFeed;
 class MomentOverview;
 class MoveData;
+struct MemoryReport;
 }
 
 class QueryResult;
@@ -24,6 +32,9 @@ class QueryResult;
  * Interactions with this manager is mostly facilitated through
  * objects designed for external message passing.
  * The internal game logic is not thread-safe, but not global data is used.
+ * Other threads may read the game through the snapshots returned by
+ * @c snapshot, if the game publishes them, and the records of new moments
+ * published to @c moment_feed instead.
  */
 class AntitelephoneGame {
   public:
@@ -31,6 +42,11 @@ class AntitelephoneGame {
     using Moment = timeplane::Moment;
     using MomentOverview = external::MomentOverview;
     using MoveData = external::MoveData;
+    using MemoryReport = external::MemoryReport;
+    using GameSnapshot = external::GameSnapshot;
+    using MomentFeed = external::MomentFeed;
+    using PlayerHistory = roundinfo::PlayerHistory;
+    using DivergenceIndex = roundinfo::DivergenceIndex;
 
     /**
      * @brief Number of valid locations added for every player in the game.
@@ -57,14 +73,42 @@ class AntitelephoneGame {
      */
     static double constexpr kFamiliarEncounterMultiplier = 1.5;
 
+    /**
+     * @brief Constant representing that moment data is never spilled.
+     */
+    static int constexpr kNoSpillHorizon = -1;
+
+    /**
+     * @brief Number of new moments kept for readers of the moment feed.
+     */
+    static int constexpr kMomentFeedCapacity = 256;
+
     /**
      * @brief Constructor.
      * @param game_id           A numeric ID assigned to the game.
      * @param num_players       The number of players in the game.
      * @param random_seed       A seed for random number generation.
+     * @param retain_all_timelines      Whether to keep every timeline
+     *      and the data of all its moments for the whole game, for the
+     *      purpose of post-game analysis.
+     * @param defer_cleanup     Whether to postpone cleaning up the data of
+     *      moments that are no longer accessible until @c Collect is
+     *      called, which keeps the clean up out of time travel moves.
+     * @param spill_horizon     The number of rounds behind the latest
+     *      moment after which the data of moments is moved out of RAM to a
+     *      temporary file, or @c kNoSpillHorizon to keep all data in RAM.
+     *      Spilled data is read back transparently whenever it is needed.
+     * @param publish_snapshots     Whether to publish the snapshots
+     *      returned by @c snapshot, which costs recording the effects and
+     *      state of every item at every moment.
+     * @throws std::runtime_error If the temporary file cannot be created.
      */
     AntitelephoneGame(int game_id, int num_players,
-                      uint64_t random_seed = 1337133713371337UL);
+                      uint64_t random_seed = 1337133713371337UL,
+                      bool retain_all_timelines = false,
+                      bool defer_cleanup = false,
+                      int spill_horizon = kNoSpillHorizon,
+                      bool publish_snapshots = false);
 
     /**
      * @brief Accessor for the timeplane manager.
@@ -72,6 +116,43 @@ class AntitelephoneGame {
      */
     TimePlane const& time_plane() const noexcept;
 
+    /**
+     * @brief Accessor for the history of every player.
+     * @return A reference to the @c PlayerHistory instance stored
+     *      internally, which holds every moment not yet reclaimed.
+     */
+    PlayerHistory const& player_history() const noexcept;
+
+    /**
+     * @brief Accessor for where the rightmost timeline diverges.
+     * @return A reference to the @c DivergenceIndex instance stored
+     *      internally, which covers the rounds replayed since the latest
+     *      antitelephone move.
+     */
+    DivergenceIndex const& divergence_index() const noexcept;
+
+    /**
+     * @brief Takes the latest snapshot of the game.
+     *
+     * Unlike every other member function, this one may be called from any
+     * thread while the game is in use. The snapshot reflects the game as of
+     * the last completed round, travel or collection, and remains valid
+     * and unchanged for as long as it is held.
+     * @return A shared pointer to the snapshot, or @c nullptr if the game
+     *      does not publish snapshots.
+     */
+    std::shared_ptr<GameSnapshot const> snapshot() const;
+
+    /**
+     * @brief Accessor for the feed of newly created moments.
+     *
+     * Like @c snapshot, the feed may be read from any thread. Every moment
+     * is published as soon as it is created, without ever blocking the
+     * game on its readers.
+     * @return A reference to the @c MomentFeed instance stored internally.
+     */
+    MomentFeed const& moment_feed() const noexcept;
+
     /**
      * @brief Alias for the result of a query for a moment overview.
      */
@@ -106,6 +187,24 @@ class AntitelephoneGame {
      */
     QueryResult MakeAntitelephoneMove(int player, int dest_time);
 
+    /**
+     * @brief Cleans up the data of moments that are no longer accessible.
+     *
+     * This is meant to be called while the game is idle, if the clean up
+     * was deferred. Moments awaiting clean up are never visible through
+     * @c GetOverview in the meantime.
+     */
+    void Collect();
+
+    /**
+     * @brief Summarizes the memory held by the game.
+     *
+     * The cost grows with the number of timelines and players, but not
+     * with the number of moments, so it can be called every round.
+     * @return The moments held and the usage of every store of data.
+     */
+    MemoryReport memory_report() const;
+
     /**
      * @brief Alias for the type of a handler called for every new round.
      *
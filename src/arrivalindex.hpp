@@ -0,0 +1,146 @@
+#ifndef ARRIVAL_INDEX_H
+#define ARRIVAL_INDEX_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "moment.hpp"
+
+namespace timeplane {
+
+/**
+ * @brief A sorted record of every antitelephone arrival in a timeplane.
+ *
+ * Every new timeline is created by an arrival, which branches from the
+ * latest moment of the rightmost timeline back to an earlier time. The
+ * arrivals are kept in order of their branch times, with ties in order
+ * of creation, so the arrivals within a range of times are found by
+ * binary search.
+ */
+class ArrivalIndex {
+  public:
+    /**
+     * @brief Constant representing that the traveller is not known.
+     */
+    static int constexpr kUnknownTraveller = -1;
+
+    /**
+     * @brief The record of one antitelephone arrival.
+     */
+    struct Arrival {
+        /**
+         * @brief The time arrived at, which is the time of the first
+         * moment of the new timeline.
+         */
+        int branch_time;
+
+        /**
+         * @brief The moment departed from.
+         */
+        Moment source;
+
+        /**
+         * @brief The ID of the player who travelled, or
+         * @c kUnknownTraveller.
+         */
+        int traveller;
+
+        /**
+         * @brief The timeline number of the timeline created.
+         */
+        int timeline_num;
+    };
+
+    using Iterator = std::vector<Arrival>::const_iterator;
+
+    /**
+     * @brief Default constructor.
+     */
+    ArrivalIndex()
+        :arrivals_{} {}
+
+    /**
+     * @brief Accessor for the number of arrivals.
+     * @return The number of timelines created by an arrival.
+     */
+    int size() const noexcept {
+        return static_cast<int>(arrivals_.size());
+    }
+
+    /**
+     * @brief Accessor for whether there was any arrival.
+     * @return Whether no arrival has been recorded.
+     */
+    bool empty() const noexcept {
+        return arrivals_.empty();
+    }
+
+    /**
+     * @brief Accessor for the latest time arrived at.
+     * @return The latest branch time of any arrival.
+     * @throws std::out_of_range If no arrival has been recorded.
+     */
+    int latest_branch_time() const {
+        if (arrivals_.empty()) {
+            throw std::out_of_range("No arrival has been recorded.");
+        }
+        return arrivals_.back().branch_time;
+    }
+
+    /**
+     * @brief Iterator to the earliest arrival.
+     * @return An iterator to the first arrival in order of branch times.
+     */
+    Iterator begin() const noexcept {
+        return arrivals_.begin();
+    }
+
+    /**
+     * @brief Iterator past the latest arrival.
+     * @return An iterator past the last arrival in order of branch times.
+     */
+    Iterator end() const noexcept {
+        return arrivals_.end();
+    }
+
+    /**
+     * @brief Records a new arrival.
+     *
+     * The cost is linear in the number of arrivals at later times.
+     * @param arrival       The arrival to record.
+     */
+    void Add(Arrival const& arrival) {
+        auto position = std::upper_bound(
+            arrivals_.begin(), arrivals_.end(), arrival.branch_time,
+            [] (int time, Arrival const& other) {
+                return time < other.branch_time;
+            });
+        arrivals_.insert(position, arrival);
+    }
+
+    /**
+     * @brief Finds the arrivals within a range of times.
+     * @param begin_time        The earliest branch time included.
+     * @param end_time          The branch time one past the latest included.
+     * @return The iterators bounding the arrivals at those times, in order
+     *      of branch times.
+     */
+    std::pair<Iterator, Iterator> Range(int begin_time, int end_time) const {
+        auto before = [] (Arrival const& arrival, int time) {
+            return arrival.branch_time < time;
+        };
+        Iterator first = std::lower_bound(arrivals_.begin(), arrivals_.end(),
+                                          begin_time, before);
+        Iterator last = std::lower_bound(first, arrivals_.end(),
+                                         std::max(begin_time, end_time),
+                                         before);
+        return std::make_pair(first, last);
+    }
+
+  private:
+    std::vector<Arrival> arrivals_;
+};
+}
+
+#endif //ARRIVAL_INDEX_H
@@ -0,0 +1,125 @@
+#ifndef BLOCK_ARENA_H
+#define BLOCK_ARENA_H
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace timeplane {
+
+/**
+ * @brief An allocator of equally sized blocks of memory.
+ *
+ * Blocks are carved out of large chunks by bumping a pointer, and blocks
+ * that are given back are kept in a free list to be handed out again.
+ * Chunks are only released when the arena is destroyed, so the arena must
+ * outlive every block allocated from it. The arena is not thread-safe.
+ */
+class BlockArena {
+  public:
+    /**
+     * @brief Constructor.
+     * @param block_size            The size in bytes of each block.
+     * @param blocks_per_chunk      The number of blocks in each chunk.
+     */
+    explicit BlockArena(std::size_t block_size, int blocks_per_chunk = 64)
+        :block_size_{RoundUp(block_size)},
+         blocks_per_chunk_{blocks_per_chunk},
+         chunks_(),
+         next_{nullptr},
+         end_{nullptr},
+         free_list_{nullptr},
+         num_allocated_{0} {
+        assert(blocks_per_chunk > 0);
+    }
+
+    /**
+     * @brief Accessor for the size of each block.
+     * @return The size in bytes of each block, after padding for alignment.
+     */
+    std::size_t block_size() const noexcept {
+        return block_size_;
+    }
+
+    /**
+     * @brief Accessor for the number of blocks in use.
+     * @return The number of blocks allocated and not yet deallocated.
+     */
+    int num_allocated() const noexcept {
+        return num_allocated_;
+    }
+
+    /**
+     * @brief Accessor for the number of chunks held.
+     * @return The number of chunks allocated from the system.
+     */
+    int num_chunks() const noexcept {
+        return static_cast<int>(chunks_.size());
+    }
+
+    /**
+     * @brief Allocates a block.
+     *
+     * Blocks are suitably aligned for any object that fits in them.
+     * @return A pointer to the uninitialized block.
+     */
+    void* Allocate() {
+        num_allocated_++;
+        if (free_list_ != nullptr) {
+            FreeBlock* result = free_list_;
+            free_list_ = result->next;
+            return result;
+        }
+        if (next_ == end_) {
+            std::size_t chunk_size = block_size_ * blocks_per_chunk_;
+            chunks_.emplace_back(new Storage[chunk_size / sizeof(Storage)]);
+            next_ = reinterpret_cast<unsigned char*>(chunks_.back().get());
+            end_ = next_ + chunk_size;
+        }
+        void* result = next_;
+        next_ += block_size_;
+        return result;
+    }
+
+    /**
+     * @brief Returns a block to the arena for reuse.
+     * @param block     A block previously allocated from the instance.
+     */
+    void Deallocate(void* block) noexcept {
+        assert(num_allocated_ > 0);
+        num_allocated_--;
+        FreeBlock* freed = static_cast<FreeBlock*>(block);
+        freed->next = free_list_;
+        free_list_ = freed;
+    }
+
+    BlockArena(BlockArena const&) = delete;
+    BlockArena& operator=(BlockArena const&) = delete;
+
+  private:
+    using Storage = std::max_align_t;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    std::size_t const block_size_;
+    int const blocks_per_chunk_;
+    std::vector<std::unique_ptr<Storage[]>> chunks_;
+    unsigned char* next_;
+    unsigned char* end_;
+    FreeBlock* free_list_;
+    int num_allocated_;
+
+    static std::size_t RoundUp(std::size_t block_size) noexcept {
+        std::size_t unit = sizeof(Storage);
+        if (block_size < sizeof(FreeBlock)) {
+            block_size = sizeof(FreeBlock);
+        }
+        return (block_size + unit - 1) / unit * unit;
+    }
+};
+}
+
+#endif //BLOCK_ARENA_H
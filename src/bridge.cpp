@@ -6,8 +6,8 @@
 
 using namespace item;
 
-Bridge::Bridge(Moment first_moment)
-    :Item{first_moment, FirstProperties()} {}
+Bridge::Bridge(Moment first_moment, ItemStateTable* table, int column)
+    :Item{first_moment, FirstProperties(), table, column} {}
 
 ItemProperties Bridge::FirstProperties() noexcept {
     ItemProperties result{};
@@ -67,25 +67,34 @@ std::pair<Effect, ItemProperties> Bridge::BranchImpl(
     return result;
 }
 
-TaggedValues Bridge::StateTaggedValues(Moment m) const {
+int Bridge::EarliestDestination(Moment m) const {
+    /* Destinations must share the startup time of the moment traveled
+     * from, and no moment before the startup time can have it. If the
+     * Bridge is inactive, it can at best start up after the moment. */
+    int value = GetProperties(m).custom(kStartupTimeID);
+    if (value > 0) {
+        return value;
+    }
+    return m.time() + 1;
+}
+
+StateTags Bridge::State(Moment m) const {
     ItemProperties const& properties = GetProperties(m);
-    TaggedValues result;
+    StateTags result;
     int lockdown = properties.lockdown();
     if (lockdown > 0) {
-        result.emplace_back("unlock_requirement", std::to_string(lockdown));
+        result.Add(StateTag::kUnlockRequirement, lockdown);
     } else {
         int value = properties.custom(kStartupTimeID);
         int cooldown = properties.cooldown();
         if (value < 0) {
-            result.emplace_back("bridge_activated", "Inactive");
-            result.emplace_back("activation_energy",
-                                std::to_string(cooldown + 1));
+            result.Add(StateTag::kBridgeActivated, false);
+            result.Add(StateTag::kActivationEnergy, cooldown + 1);
         } else {
-            result.emplace_back("bridge_activated", "Active");
-            result.emplace_back("bridge_charge_remaining",
-                                std::to_string(kMaxCooldown - cooldown));
-            result.emplace_back("bridge_startup_time",
-                                std::to_string(value));
+            result.Add(StateTag::kBridgeActivated, true);
+            result.Add(StateTag::kBridgeChargeRemaining,
+                       kMaxCooldown - cooldown);
+            result.Add(StateTag::kBridgeStartupTime, value);
         }
     }
     return result;
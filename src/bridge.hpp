@@ -13,7 +13,7 @@ namespace item {
  * arrival lies in between can be connected with the Bridge. Then it would
  * be possible to travel from the later moment to the earlier moment.
  */
-class Bridge : public Item {
+class Bridge final : public Item {
   public:
     /**
      * @brief An enum representation of the type of the item.
@@ -28,11 +28,14 @@ class Bridge : public Item {
      */
     static int constexpr kUnlockRequirement = 45;
 
-    Bridge(Moment first_moment);
+    Bridge(Moment first_moment, ItemStateTable* table = nullptr,
+           int column = 0);
 
     Effect View(Moment m) const;
 
-    TaggedValues StateTaggedValues(Moment m) const;
+    StateTags State(Moment m) const;
+
+    int EarliestDestination(Moment m) const;
 
   protected:
     std::pair<Effect, ItemProperties> StepImpl(Moment curr,
@@ -42,6 +45,8 @@ class Bridge : public Item {
         Moment curr, Moment dest);
 
   private:
+    friend class ItemSet;
+
     /* ID for a property that encodes whether the item is active
      * and a unique value for each set of moments that are connected
      * by the bridge, which is chosen to be the time of activation
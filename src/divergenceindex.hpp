@@ -0,0 +1,109 @@
+#ifndef DIVERGENCE_INDEX_H
+#define DIVERGENCE_INDEX_H
+
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+#include "aliases.hpp"
+
+namespace roundinfo {
+
+/**
+ * @brief A record of where the rightmost timeline diverges from the
+ * second-rightmost timeline.
+ *
+ * For every round replayed in the rightmost timeline, the set of players
+ * sharing each player's location in the second-rightmost timeline is
+ * compared with the set of players that player encounters in the rightmost
+ * timeline. Neither set includes the player themself. The index keeps the
+ * first time these sets differed for every player since the latest branch.
+ *
+ * The game only reads the index to decide the antiplayer's bonus for a
+ * familiar encounter. Sleeping players are woken every round without it.
+ */
+class DivergenceIndex {
+  public:
+    /**
+     * @brief Constant representing that a player has not diverged.
+     */
+    static int constexpr kNotDiverged = -1;
+
+    /**
+     * @brief Constructor.
+     * @param num_players       The number of players in the game.
+     */
+    explicit DivergenceIndex(int num_players)
+        :first_divergence_(num_players, int{kNotDiverged}),
+         diverged_{0} {
+        assert(num_players <= 8 * static_cast<int>(sizeof(PlayerMask)));
+    }
+
+    /**
+     * @brief Accessor for the players that have diverged.
+     * @return The set of players whose encounters differed at any time
+     *      since the latest branch.
+     */
+    PlayerMask diverged() const noexcept {
+        return diverged_;
+    }
+
+    /**
+     * @brief Accessor for the first divergence of a player.
+     * @param player        The player ID to query.
+     * @return The first time the encounters of the player differed since
+     *      the latest branch, or @c kNotDiverged if they never did.
+     * @throws std::out_of_range If no player with the specified ID exists.
+     */
+    int first_divergence(int player) const {
+        return first_divergence_.at(player);
+    }
+
+    /**
+     * @brief Compares the encounters of every player at a time.
+     *
+     * @param time          The time of the round compared.
+     * @param expected      For every player, the other players that shared
+     *      their location in the second-rightmost timeline.
+     * @param actual        For every player, the other players they
+     *      encounter in the rightmost timeline.
+     * @return The set of players whose encounters differ at the time.
+     */
+    PlayerMask Update(int time, std::vector<PlayerMask> const& expected,
+                      std::vector<PlayerMask> const& actual) {
+        assert(expected.size() == first_divergence_.size());
+        assert(actual.size() == first_divergence_.size());
+        PlayerMask result = 0;
+        int num_players = static_cast<int>(first_divergence_.size());
+        for (int player = 0; player < num_players; player++) {
+            if (expected[player] != actual[player]) {
+                result |= PlayerMask{1} << player;
+            }
+        }
+        PlayerMask newly_diverged = result & ~diverged_;
+        for (int player = 0; newly_diverged != 0; player++) {
+            if (newly_diverged & (PlayerMask{1} << player)) {
+                first_divergence_[player] = time;
+                newly_diverged &= ~(PlayerMask{1} << player);
+            }
+        }
+        diverged_ |= result;
+        return result;
+    }
+
+    /**
+     * @brief Forgets every divergence, as needed after a new branch.
+     */
+    void Reset() noexcept {
+        for (int& time: first_divergence_) {
+            time = kNotDiverged;
+        }
+        diverged_ = 0;
+    }
+
+  private:
+    std::vector<int> first_divergence_;
+    PlayerMask diverged_;
+};
+}
+
+#endif //DIVERGENCE_INDEX_H
@@ -0,0 +1,39 @@
+#include "gamesnapshot.hpp"
+#include "roundinfoview.hpp"
+
+using namespace external;
+using roundinfo::RoundInfoView;
+
+bool GameSnapshot::IsAccessible(Moment m) const noexcept {
+    int timeline_num = m.parent_timeline_num();
+    if (round_info_.count(m) == 0) {
+        return false;
+    }
+    if (timeline_num < num_retained_) {
+        return true;
+    }
+    for (timeplane::TimeLine::Span const& span: reachable_) {
+        if (span.timeline_num == timeline_num &&
+                m.time() >= span.begin_time && m.time() < span.end_time) {
+            return true;
+        }
+    }
+    return false;
+}
+
+GameSnapshot::MomentOverviewQueryResult GameSnapshot::GetOverview(
+        int player, Moment m) const {
+    std::shared_ptr<roundinfo::RoundInfo const> info = round_info_.Find(m);
+    std::shared_ptr<MomentRecord const> record = records_.Find(m);
+    bool from_rightmost =
+        (m.parent_timeline_num() == latest_moment_.parent_timeline_num());
+    if (player < 0 || player >= num_players_ ||
+            (!from_rightmost && player != antiplayer_) ||
+            info == nullptr || record == nullptr || !IsAccessible(m)) {
+        return std::make_pair(QueryResult{false, "bad_request"},
+                              boost::none);
+    }
+    return std::make_pair(QueryResult{}, MomentOverview{
+        m, record->effects[player], record->item_state_data[player],
+        RoundInfoView{*info, player, !from_rightmost}});
+}
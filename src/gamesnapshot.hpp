@@ -0,0 +1,142 @@
+#ifndef GAME_SNAPSHOT_H
+#define GAME_SNAPSHOT_H
+
+#include <cassert>
+#include <utility>
+#include <vector>
+#include <boost/optional.hpp>
+#include <boost/serialization/array.hpp>
+#include <boost/serialization/vector.hpp>
+#include "moment.hpp"
+#include "sharedmomentmap.hpp"
+#include "timeline.hpp"
+#include "roundinfo.hpp"
+#include "effect.hpp"
+#include "momentoverview.hpp"
+#include "queryresult.hpp"
+
+namespace external {
+
+/**
+ * @brief An immutable view of a game as of a completed round.
+ *
+ * The snapshot holds everything needed to answer queries for moment
+ * overviews, sharing the data of old moments with the game and with other
+ * snapshots. Since nothing in it ever changes, any number of threads may
+ * query the same snapshot while the game keeps processing moves.
+ */
+class GameSnapshot {
+  public:
+    /**
+     * @brief Alias for the result of a query for a moment overview.
+     */
+    using MomentOverviewQueryResult =
+        std::pair<QueryResult, boost::optional<MomentOverview>>;
+
+    /**
+     * @brief The item data needed to overview a moment for any player.
+     */
+    struct MomentRecord {
+        /**
+         * @brief The effects of the items of each player at the moment.
+         */
+        std::vector<Effect> effects;
+
+        /**
+         * @brief The state of the items of each player at the moment.
+         */
+        std::vector<MomentOverview::StateTagsArr> item_state_data;
+
+        /**
+         * @brief Serialization function.
+         *
+         * @tparam Archive      The serialization archive type.
+         * @param ar            The serialization archive.
+         * @param version       The verion of the serialization protocol to use.
+         */
+        template <typename Archive>
+        void serialize(Archive& ar, unsigned int const version) {
+            (void)version;
+            assert(version == 0);
+            ar & effects & item_state_data;
+        }
+    };
+
+    /**
+     * @brief Constructor.
+     * @param num_players       The number of players in the game.
+     * @param antiplayer        The player who may view moments outside the
+     *      rightmost timeline, or a negative number if there is none.
+     * @param latest_moment     The latest moment of the rightmost timeline.
+     * @param reachable         The spans of moments reachable from the
+     *      rightmost and second-rightmost timelines.
+     * @param num_retained      The timelines numbered below this are kept
+     *      for the whole game, so all of their moments remain accessible.
+     * @param round_info        Information about the rounds of the moments,
+     *      shared with the game.
+     * @param records           The item data of the same moments.
+     */
+    GameSnapshot(int num_players, int antiplayer, Moment latest_moment,
+                 std::vector<timeplane::TimeLine::Span> reachable,
+                 int num_retained,
+                 timeplane::SharedMomentMap<roundinfo::RoundInfo> round_info,
+                 timeplane::SharedMomentMap<MomentRecord> records)
+        :num_players_{num_players},
+         antiplayer_{antiplayer},
+         latest_moment_{latest_moment},
+         reachable_{std::move(reachable)},
+         num_retained_{num_retained},
+         round_info_{std::move(round_info)},
+         records_{std::move(records)} {}
+
+    /**
+     * @brief Accessor for the latest moment of the rightmost timeline.
+     * @return The moment created by the last completed round.
+     */
+    Moment latest_moment() const noexcept {
+        return latest_moment_;
+    }
+
+    /**
+     * @brief Accessor for the number of moments with stored data.
+     * @return The number of moments held by the snapshot, which covers
+     *      the timelines it can reach, including moments of them that are
+     *      no longer accessible.
+     */
+    int num_moments() const noexcept {
+        return round_info_.size();
+    }
+
+    /**
+     * @brief Checks whether a moment was accessible as of the snapshot.
+     * @param m     The moment to query.
+     * @return Whether the moment could be reached from any timeline that
+     *      was not discarded.
+     */
+    bool IsAccessible(Moment m) const noexcept;
+
+    /**
+     * @brief Gets a moment overview from the perspective of a player.
+     *
+     * The result is the same as that of @c AntitelephoneGame::GetOverview
+     * at the time the snapshot was taken.
+     * @param player        The ID of the player.
+     * @param m             The moment to overview.
+     * @return The result of the query, and the overview if it succeeded.
+     * @throws std::runtime_error If the record of a spilled moment cannot
+     *      be read back.
+     */
+    MomentOverviewQueryResult GetOverview(int player, Moment m) const;
+
+  private:
+    int num_players_;
+    int antiplayer_;
+    Moment latest_moment_;
+    std::vector<timeplane::TimeLine::Span> reachable_;
+    int num_retained_;
+    timeplane::SharedMomentMap<roundinfo::RoundInfo> round_info_;
+    timeplane::SharedMomentMap<MomentRecord> records_;
+};
+}
+
+#endif //GAME_SNAPSHOT_H
@@ -1,52 +1,107 @@
+#include <algorithm>
+#include <cassert>
+#include <memory>
 #include "moment.hpp"
 #include "effect.hpp"
 #include "roundinfoview.hpp"
 #include "itemproperties.hpp"
 #include "item.hpp"
 
-#include <algorithm>
-
 using namespace item;
 
+namespace {
+/* Any energy beyond this activates an unlocked item regardless of its
+ * cooldown, so larger inputs share the entries of this one. */
+int constexpr kMaxUsefulEnergy = Item::kMaxCooldown + 2;
+
+/* The result of putting energy into an item that is not locked down */
+struct StepTransition {
+    int cooldown;
+    bool activated;
+};
+
+struct StepTransitionTable {
+    // Indexed by cooldown and then by energy input
+    StepTransition at[Item::kMaxCooldown + 1][kMaxUsefulEnergy + 1];
+};
+
+constexpr StepTransitionTable MakeStepTransitionTable() {
+    StepTransitionTable result{};
+    for (int cooldown = 0; cooldown <= Item::kMaxCooldown; cooldown++) {
+        for (int energy = 0; energy <= kMaxUsefulEnergy; energy++) {
+            StepTransition& transition = result.at[cooldown][energy];
+            transition.activated = cooldown < energy - 1;
+            transition.cooldown = transition.activated ? 0 :
+                std::min(cooldown - energy + 1, Item::kMaxCooldown);
+        }
+    }
+    return result;
+}
+
+constexpr StepTransitionTable kStepTransitions = MakeStepTransitionTable();
+
+static_assert(kStepTransitions.at[0][0].cooldown == 1 &&
+              !kStepTransitions.at[0][0].activated,
+              "Idle items cool down");
+static_assert(kStepTransitions.at[Item::kMaxCooldown][0].cooldown ==
+              Item::kMaxCooldown, "Cooldown is capped");
+static_assert(kStepTransitions.at[Item::kMaxCooldown]
+              [kMaxUsefulEnergy].activated,
+              "Enough energy activates any item");
+}
+
 Effect Item::Step(Moment curr, RoundInfoView const& round_info_view,
                   int energy_input) {
     if (round_info_view.HealthRemaining(round_info_view.player()) == 0) {
         // Player is dead, and can't input any energy.
         energy_input = 0;
     }
-    std::pair<Effect, ItemProperties> pair =
-        StepImpl(curr, round_info_view, energy_input);
-    pending_new_properties_ = std::move(pair.second);
-    return pair.first;
+    return SetPending(StepImpl(curr, round_info_view, energy_input));
 }
 
 Effect Item::Branch(Moment curr, Moment dest) {
     if (dest.time() >= curr.time()) {
         throw std::invalid_argument("Destination is not in the past");
     }
-    std::pair<Effect, ItemProperties> pair = BranchImpl(curr, dest);
-    pending_new_properties_ = std::move(pair.second);
+    return SetPending(BranchImpl(curr, dest));
+}
+
+Effect Item::SetPending(std::pair<Effect, ItemProperties>&& pair) {
+    table_->Stage(column_, pair.second);
     return pair.first;
 }
 
 void Item::Duplicate(Moment to_duplicate) {
-    pending_new_properties_ = GetProperties(to_duplicate);
+    table_->Stage(column_, GetProperties(to_duplicate));
+}
+
+void Item::Duplicate(PropertiesPool::Handle to_duplicate) {
+    table_->Stage(column_, to_duplicate);
 }
 
 void Item::ConfirmPending(Moment new_moment) {
-    if (!pending_new_properties_) {
+    if (!table_->IsStaged(column_)) {
         throw std::runtime_error("Item does not have pending properties");
     }
-    properties_.emplace(new_moment, std::move(pending_new_properties_.get()));
-    pending_new_properties_ = boost::none;
+    table_->Commit(new_moment, column_);
+}
+
+Item::Item(Moment first_moment, ItemProperties const& first_properties,
+           ItemStateTable* table, int column)
+    :own_table_{table == nullptr ? std::make_unique<ItemStateTable>(1)
+                                 : nullptr},
+     table_{table == nullptr ? own_table_.get() : table},
+     column_{table == nullptr ? 0 : column} {
+    assert(column_ >= 0 && column_ < table_->num_columns());
+    table_->Set(first_moment, column_, first_properties);
 }
 
-Item::Item(Moment first_moment, ItemProperties const& first_properties) {
-    properties_.emplace(first_moment, first_properties);
+ItemProperties const& Item::GetProperties(Moment m) const {
+    return table_->at(m, column_);
 }
 
-inline ItemProperties const& Item::GetProperties(Moment m) const {
-    return properties_.at(m);
+TaggedValues Item::StateTaggedValues(Moment m) const {
+    return FormatStateTags(State(m));
 }
 
 Item::~Item() {}
@@ -70,6 +125,25 @@ Effect Item::IncrementEffectIf(Moment m) const {
 
 bool Item::StandardStepUpdate(ItemProperties& properties,
                               int energy_input) {
+    assert(energy_input >= 0);
+    int lockdown = properties.lockdown();
+    int cooldown = properties.cooldown();
+    if (cooldown < 0 || cooldown > kMaxCooldown) {
+        // Only reachable through unusual damage, so not worth a table entry
+        return StandardStepUpdateSlow(properties, energy_input);
+    }
+    bool unlocked = lockdown <= energy_input;
+    int remaining = std::min(std::max(energy_input - lockdown, 0),
+                             kMaxUsefulEnergy);
+    StepTransition const& transition =
+        kStepTransitions.at[cooldown][remaining];
+    properties.set_lockdown(std::max(lockdown - energy_input, 0));
+    properties.set_cooldown(unlocked ? transition.cooldown : cooldown);
+    return unlocked && transition.activated;
+}
+
+bool Item::StandardStepUpdateSlow(ItemProperties& properties,
+                                  int energy_input) {
     int lockdown = properties.lockdown();
     if (lockdown <= energy_input) {
         properties.set_lockdown(0);
@@ -90,9 +164,18 @@ bool Item::StandardStepUpdate(ItemProperties& properties,
     return false;
 }
 
-void Item::MomentDeleter(timeplane::MomentIterators iterators) {
-    std::for_each(iterators.first, iterators.second,
-    [this] (Moment m) {
-        this->properties_.erase(m);
-    });
+int Item::EarliestDestination(Moment) const {
+    return kNoDestination;
+}
+
+int Item::Reclaim(timeplane::RetirementLog const& log, int epoch) {
+    return own_table_ ? own_table_->Reclaim(log, epoch) : 0;
+}
+
+int Item::Spill(timeplane::SpillFile& file, int before_time) {
+    return own_table_ ? own_table_->Spill(file, before_time) : 0;
+}
+
+timeplane::StoreUsage Item::properties_usage() const noexcept {
+    return table_->usage();
 }
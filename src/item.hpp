@@ -1,10 +1,12 @@
 #ifndef ITEM_H
 #define ITEM_H
 
-#include <unordered_map>
-#include <boost/optional.hpp>
+#include <limits>
 #include "moment.hpp"
+#include "tieredmomentmap.hpp"
 #include "itemproperties.hpp"
+#include "itemstatetable.hpp"
+#include "statetags.hpp"
 #include "aliases.hpp"
 
 namespace roundinfo {
@@ -58,8 +60,9 @@ class Item {
     /**
      * @brief Update the item across a regular step into the future.
      *
-     * The resulting item properties are stored temporarily until the client
-     * calls @c ConfirmPending to finalize them. The item properties are
+     * The resulting item properties are staged in the table of the item
+     * until the client calls @c ConfirmPending, or commits the whole table,
+     * to finalize them. The item properties are
      * updated after considering the events that have occurred in the turn.
      * The round information parameter is in a past-oriented state, so all
      * future-oriented values in the instance is unspecified.
@@ -74,8 +77,9 @@ class Item {
     /**
      * @brief Update the item while traveling to the past (branching).
      *
-     * The resulting item properties are stored temporarily until the client
-     * calls @c ConfirmPending to finalize them.
+     * The resulting item properties are staged in the table of the item
+     * until the client calls @c ConfirmPending, or commits the whole table,
+     * to finalize them.
      * @param curr          The current moment before branching.
      * @param dest          The destination moment to reach.
      * @return The effects granted by the item for the next round.
@@ -91,6 +95,7 @@ class Item {
      * provided to @c Step, or has the same time as the destination moment
      * providede to @c Branch.
      * @param new_moment        The moment to associate with item changes.
+     * @throws std::runtime_error If the item has no staged properties.
      */
     void ConfirmPending(Moment new_moment);
 
@@ -108,48 +113,123 @@ class Item {
     /**
      * @brief Duplicates the item properties at the specified moment.
      *
-     * The resulting item properties are stored temporarily until the client
-     * calls @c ConfirmPending to finalize them.
+     * The resulting item properties are staged in the table of the item
+     * until the client calls @c ConfirmPending, or commits the whole table,
+     * to finalize them.
      * @param to_duplicate      The moment whose properties are duplicated.
      * @throws std::out_of_range If no properties are stored for the moment.
      */
     void Duplicate(Moment to_duplicate);
 
     /**
-     * @brief Virtual method to provide user-friendly tagged values.
+     * @brief Duplicates item properties captured from an earlier moment.
+     *
+     * The resulting item properties are staged in the table of the item
+     * until the client calls @c ConfirmPending, or commits the whole table,
+     * to finalize them.
+     * @param to_duplicate      The handle to the properties to duplicate,
+     *      as obtained from @c ItemStateTable::HandlesAt of the table of
+     *      the item.
+     */
+    void Duplicate(PropertiesPool::Handle to_duplicate);
+
+    /**
+     * @brief Accessor for the properties of an item at a specific moment.
+     * @param m     The moment to query.
+     * @return The properties of the item at the specified moment.
+     * @throws std::out_of_range If no properties are stored for the moment.
+     */
+    ItemProperties const& GetProperties(Moment m) const;
+
+    /**
+     * @brief Virtual method to describe the state of the item with tags.
      *
      * The tags are used as a user-friendly indication of the internal
      * state of the item at a given moment without revealing implementation
      * detail, and can also be used to attach specific meaning to the
      * abstract lockdown and cooldown values associated with all items.
+     * The tags are structured, and building them never allocates.
+     * @param m     The moment to query.
+     * @return The tags describing the state of an item.
+     */
+    virtual StateTags State(Moment m) const = 0;
+
+    /**
+     * @brief Provides the user-friendly form of the state of the item.
      * @param m     The moment to query.
      * @return A group of tagged values describing the state of an item.
+     * @see FormatStateTags
      */
-    virtual TaggedValues StateTaggedValues(Moment m) const = 0;
+    TaggedValues StateTaggedValues(Moment m) const;
+
+    /**
+     * @brief Constant representing that no destination is ever allowed.
+     */
+    static int constexpr kNoDestination = std::numeric_limits<int>::max();
+
+    /**
+     * @brief Earliest antitelephone destination the item could allow.
+     *
+     * The result is a lower bound on the time of any destination that the
+     * item explicitly allows, when traveling from the specified moment or
+     * any later moment in the same timeline.
+     * @param m     The moment to query.
+     * @return The earliest time the item could allow, or
+     *      @c kNoDestination if the item never allows any destination.
+     * @throws std::out_of_range Potentially thrown by subclasses.
+     */
+    virtual int EarliestDestination(Moment m) const;
 
     virtual ~Item();
 
     /**
      * @brief Function to clean up data related to inaccessible moments.
-     * @param iterators     A pair of constant input iterators to moments
-     *      that will soon become inaccessible.
+     *
+     * Items sharing a table only clean up when the table is theirs.
+     * @param log       The log of moments that are no longer accessible.
+     * @param epoch     The epoch up to which data was already cleaned up.
+     * @return The number of moments whose data was cleaned up.
+     */
+    int Reclaim(timeplane::RetirementLog const& log, int epoch);
+
+    /**
+     * @brief Function to move the data of old moments out to a file.
+     *
+     * Items sharing a table only spill when the table is theirs.
+     * @param file              The file to write the data to.
+     * @param before_time       The data of all moments before this time
+     *      is moved out.
+     * @return The number of moments whose data was moved out.
+     */
+    int Spill(timeplane::SpillFile& file, int before_time);
+
+    /**
+     * @brief Summarizes the memory used by the table of the item.
+     * @return The number of moments with properties and the approximate
+     *      bytes held for them, shared with every item in the same table.
      */
-    void MomentDeleter(timeplane::MomentIterators iterators);
+    timeplane::StoreUsage properties_usage() const noexcept;
 
   protected:
     /**
      * @brief Constructor.
+     *
+     * Without a table, the item keeps its properties in a table of its own.
      * @param first_moment          The first moment in the game.
+     * @param first_properties      The properties at the first moment.
+     * @param table                 The table to store the properties in,
+     *      which must outlive the item, or @c nullptr.
+     * @param column                The column of the item in the table.
      */
-    Item(Moment first_moment, ItemProperties const& first_properties);
+    Item(Moment first_moment, ItemProperties const& first_properties,
+         ItemStateTable* table, int column);
 
     /**
-     * @brief Accessor for the properties of an item at a specific moment.
-     * @param m     The moment to query.
-     * @return The properties of the item at the specified moment.
-     * @throws std::out_of_range If no properties are stored for the moment.
+     * @brief Move constructor.
+     *
+     * An item keeping a table of its own takes the table along with it.
      */
-    ItemProperties const& GetProperties(Moment m) const;
+    Item(Item&&) = default;
 
     /**
      * @brief @c Effect instance with basic attack and maximum hitpoints.
@@ -181,6 +261,8 @@ class Item {
     /**
      * @brief Standard update algorithm for properties.
      *
+     * The transitions of every cooldown and energy input are computed at
+     * compile time, so the update is a table lookup.
      * @param properties        The properties to update.
      * @param energy_input      The amount of energy put into the item.
      * @return Whether the item was actived as a result of the energy input.
@@ -209,8 +291,19 @@ class Item {
         Moment curr, Moment dest) = 0;
 
   private:
-    boost::optional<ItemProperties> pending_new_properties_;
-    std::unordered_map<Moment, ItemProperties> properties_;
+    // Steps every item of a player without virtual dispatch
+    friend class ItemSet;
+
+    std::unique_ptr<ItemStateTable> own_table_;
+    ItemStateTable* table_;
+    int column_;
+
+    /* The same as StandardStepUpdate without the transition table */
+    static bool StandardStepUpdateSlow(ItemProperties& properties,
+                                       int energy_input);
+
+    /* Stages the properties of a step or branch until confirmed */
+    Effect SetPending(std::pair<Effect, ItemProperties>&& pair);
 };
 }
 
@@ -1,16 +1,34 @@
 #ifndef ITEM_PROPERTIES_H
 #define ITEM_PROPERTIES_H
 
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
 #include <boost/serialization/access.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/unordered_map.hpp>
+#include <boost/serialization/version.hpp>
 
 namespace item {
 
 /**
  * @brief A class holding properties of an item at a specific moment.
+ *
+ * The instance is trivially copyable, with custom properties stored in a
+ * fixed number of inline slots, so copying it never allocates.
  */
 class ItemProperties {
   public:
+    /**
+     * @brief The number of custom properties an item can have.
+     */
+    static int constexpr kNumCustomSlots = 2;
+
     /**
      * @brief Accessor for the lockdown of the item.
      *
@@ -60,42 +78,158 @@ class ItemProperties {
      *
      * @param key       The ID of the property to access.
      * @return The value of the custom property.
-     * @throws std::out_of_range if the key is an invalid property ID.
+     * @throws std::out_of_range if the key is an invalid property ID, or
+     *      the property was never set.
      */
     int custom(int key) const {
-        return custom_.at(key);
+        if (key < 0 || key >= kNumCustomSlots ||
+                !(custom_set_ & (1u << key))) {
+            throw std::out_of_range("Custom property is not set");
+        }
+        return custom_[key];
     }
 
     /**
-     * @brief Mutator for the cooldown of the item.
+     * @brief Accessor for whether a custom property is set.
+     *
+     * @param key       The ID of the property to query.
+     * @return Whether the key is a valid property ID and the property
+     *      was set.
+     */
+    bool has_custom(int key) const noexcept {
+        return key >= 0 && key < kNumCustomSlots &&
+               (custom_set_ & (1u << key));
+    }
+
+    /**
+     * @brief Mutator for custom properties of an item.
      *
-     * @param lockdown      The ID of the property to access.
-     * @value value         The value of the custom property to set.
+     * @param key           The ID of the property to access.
+     * @param value         The value of the custom property to set.
+     * @throws std::out_of_range if the key is an invalid property ID.
      */
     void set_custom(int key, int value) {
+        if (key < 0 || key >= kNumCustomSlots) {
+            throw std::out_of_range("Custom property ID is invalid");
+        }
         custom_[key] = value;
+        custom_set_ |= 1u << key;
+    }
+
+    /**
+     * @brief Equality operator.
+     *
+     * The lockdown, cooldown and every custom property that is set are
+     * compared.
+     * @param rhs       The instance to compare against.
+     * @return Whether the instances are equal.
+     */
+    bool operator==(ItemProperties const& rhs) const noexcept {
+        if (lockdown_ != rhs.lockdown_ || cooldown_ != rhs.cooldown_ ||
+                custom_set_ != rhs.custom_set_) {
+            return false;
+        }
+        for (int i = 0; i < kNumCustomSlots; i++) {
+            if ((custom_set_ & (1u << i)) && custom_[i] != rhs.custom_[i]) {
+                return false;
+            }
+        }
+        return true;
     }
 
     /**
-     * @brief Serialization function.
+     * @brief Inequality operator.
      *
+     * @param rhs       The instance to compare against.
+     * @return Whether the instances are not equal.
+     */
+    bool operator!=(ItemProperties const& rhs) const noexcept {
+        return !(operator==(rhs));
+    }
+
+    /**
+     * @brief Serialization function for saving.
+     *
+     * @tparam Archive      The serialization archive type.
+     * @param ar            The serialization archive.
+     * @param version       The verion of the serialization protocol to use.
+     */
+    template<typename Archive>
+    void save(Archive& ar, unsigned int const version) const {
+        (void)version;
+        ar & lockdown_ & cooldown_ & custom_set_;
+        for (int i = 0; i < kNumCustomSlots; i++) {
+            // Unset slots are saved as zero rather than left indeterminate
+            int value = (custom_set_ & (1u << i)) ? custom_[i] : 0;
+            ar & value;
+        }
+    }
+
+    /**
+     * @brief Serialization function for loading.
+     *
+     * Version 0 stored the custom properties in a hash map, which is still
+     * accepted as long as every key fits in a slot.
      * @tparam Archive      The serialization archive type.
      * @param ar            The serialization archive.
      * @param version       The verion of the serialization protocol to use.
+     * @throws std::out_of_range If a version 0 key does not fit in a slot.
      */
     template<typename Archive>
-    void serialize(Archive& ar, unsigned int const version) {
-        assert(version == 0);
-        ar & lockdown_ & cooldown_ & custom_;
+    void load(Archive& ar, unsigned int const version) {
+        assert(version <= 1);
+        ar & lockdown_ & cooldown_;
+        if (version == 0) {
+            std::unordered_map<int, int> custom{};
+            ar & custom;
+            custom_set_ = 0;
+            for (auto const& entry: custom) {
+                set_custom(entry.first, entry.second);
+            }
+            return;
+        }
+        ar & custom_set_;
+        for (int& value: custom_) {
+            ar & value;
+        }
     }
 
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
   private:
     friend class boost::serialization::access;
 
     int lockdown_;
     int cooldown_;
-    std::unordered_map<int, int> custom_;
+    std::array<int, kNumCustomSlots> custom_;
+    // Bit i is set once custom property i has a value
+    unsigned custom_set_ = 0;
 };
+
+static_assert(std::is_trivially_copyable<ItemProperties>::value,
+              "Copying properties must not allocate");
 }
 
+namespace std {
+template <>
+/**
+ * @brief Hash function for @c ItemProperties instances.
+ */
+struct hash<item::ItemProperties> {
+    size_t operator()(item::ItemProperties const& p) const {
+        std::uint64_t mixed = static_cast<std::uint32_t>(p.lockdown());
+        mixed = mixed * 31 + static_cast<std::uint32_t>(p.cooldown());
+        for (int i = 0; i < item::ItemProperties::kNumCustomSlots; i++) {
+            mixed = mixed * 31 + (p.has_custom(i) ?
+                static_cast<std::uint32_t>(p.custom(i)) + 1u : 0u);
+        }
+        // Fibonacci hashing spreads the fields over the result
+        mixed *= 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(mixed ^ (mixed >> 32));
+    }
+};
+}
+
+BOOST_CLASS_VERSION(item::ItemProperties, 1)
+
 #endif //ITEM_PROPERTIES_H
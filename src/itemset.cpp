@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+#include "moment.hpp"
+#include "effect.hpp"
+#include "roundinfoview.hpp"
+#include "itemset.hpp"
+
+using namespace item;
+
+ItemSet::ItemSet(Moment first_moment, ItemStateTable* table, int player)
+    :antitelephone_{first_moment, table, player * ItemTypeCount},
+     bridge_{first_moment, table, player * ItemTypeCount + 1},
+     oracle_{first_moment, table, player * ItemTypeCount + 2},
+     shield_{first_moment, table, player * ItemTypeCount + 3} {
+    assert(ItemTypeID(Antitelephone::type) == 0);
+    assert(ItemTypeID(Bridge::type) == 1);
+    assert(ItemTypeID(Oracle::type) == 2);
+    assert(ItemTypeID(Shield::type) == 3);
+}
+
+Item& ItemSet::operator[](int id) noexcept {
+    return const_cast<Item&>(static_cast<ItemSet const&>(*this)[id]);
+}
+
+Item const& ItemSet::operator[](int id) const noexcept {
+    switch (id) {
+    case ItemTypeID(ItemType::kAntitelephone):
+        return antitelephone_;
+    case ItemTypeID(ItemType::kBridge):
+        return bridge_;
+    case ItemTypeID(ItemType::kOracle):
+        return oracle_;
+    default:
+        assert(id == ItemTypeID(ItemType::kShield));
+        return shield_;
+    }
+}
+
+Effect ItemSet::Step(Moment curr, RoundInfoView const& round_info_view,
+                     EnergyInputs const& energy_inputs) {
+    // Player is dead, and can't input any energy.
+    bool dead = round_info_view.HealthRemaining(round_info_view.player()) == 0;
+    Effect result{};
+    ForEach([&] (auto& item) {
+        int energy_input = dead ? 0 : energy_inputs[ItemTypeID(item.type)];
+        result += item.SetPending(
+            item.StepImpl(curr, round_info_view, energy_input));
+    });
+    return result;
+}
+
+Effect ItemSet::Branch(Moment curr, Moment dest) {
+    if (dest.time() >= curr.time()) {
+        throw std::invalid_argument("Destination is not in the past");
+    }
+    Effect result{};
+    ForEach([&] (auto& item) {
+        result += item.SetPending(item.BranchImpl(curr, dest));
+    });
+    return result;
+}
+
+void ItemSet::Duplicate(Moment to_duplicate) {
+    ForEach([&] (auto& item) {
+        item.Duplicate(to_duplicate);
+    });
+}
+
+void ItemSet::Duplicate(ItemStateTable::Handles const& handles,
+                        int first_column) {
+    ForEach([&] (auto& item) {
+        item.Duplicate(handles[first_column + ItemTypeID(item.type)]);
+    });
+}
+
+void ItemSet::ConfirmPending(Moment new_moment) {
+    ForEach([&] (auto& item) {
+        item.ConfirmPending(new_moment);
+    });
+}
+
+Effect ItemSet::View(Moment m) const {
+    Effect result{};
+    ForEach([&] (auto const& item) {
+        result += item.View(m);
+    });
+    return result;
+}
+
+ItemSet::StateTagsArr ItemSet::State(Moment m) const {
+    StateTagsArr result;
+    ForEach([&] (auto const& item) {
+        result[ItemTypeID(item.type)] = item.State(m);
+    });
+    return result;
+}
+
+int ItemSet::EarliestDestination(Moment m) const {
+    int result = Item::kNoDestination;
+    ForEach([&] (auto const& item) {
+        result = std::min(result, item.EarliestDestination(m));
+    });
+    return result;
+}
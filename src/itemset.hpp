@@ -0,0 +1,162 @@
+#ifndef ITEM_SET_H
+#define ITEM_SET_H
+
+#include <array>
+#include "moment.hpp"
+#include "effect.hpp"
+#include "itemtype.hpp"
+#include "itemstatetable.hpp"
+#include "statetags.hpp"
+#include "item.hpp"
+#include "antitelephone.hpp"
+#include "bridge.hpp"
+#include "oracle.hpp"
+#include "shield.hpp"
+#include "aliases.hpp"
+
+namespace item {
+
+/**
+ * @brief All the items of one player, stored by value.
+ *
+ * The concrete type of every item is known at compile time, so the items
+ * are stepped, branched and viewed through direct calls instead of the
+ * virtual methods of @c Item, and a loop over them is fully unrolled. The
+ * items behave exactly as the instances made by @c MakeItemPtrs.
+ */
+class ItemSet {
+  public:
+    /**
+     * @brief The tags describing each item, in order of their ID's.
+     */
+    using StateTagsArr = std::array<StateTags, ItemTypeCount>;
+
+    /**
+     * @brief The energy put into each item, in order of their ID's.
+     */
+    using EnergyInputs = std::array<int, ItemTypeCount>;
+
+    /**
+     * @brief Constructor.
+     * @param first_moment      The first moment of the game.
+     * @param table             The table to store the properties of the
+     *      items in, or @c nullptr for each item to keep its own.
+     * @param player            The player owning the items, which selects
+     *      their columns in the table.
+     */
+    ItemSet(Moment first_moment, ItemStateTable* table = nullptr,
+            int player = 0);
+
+    /**
+     * @brief Calls a function on every item in order of their ID's.
+     * @param f     The function to call with each item as its concrete type.
+     */
+    template <typename F>
+    void ForEach(F&& f) {
+        f(antitelephone_);
+        f(bridge_);
+        f(oracle_);
+        f(shield_);
+    }
+
+    /**
+     * @brief Calls a function on every item in order of their ID's.
+     * @param f     The function to call with each item as its concrete type.
+     */
+    template <typename F>
+    void ForEach(F&& f) const {
+        f(antitelephone_);
+        f(bridge_);
+        f(oracle_);
+        f(shield_);
+    }
+
+    /**
+     * @brief Accesses an item by its ID.
+     * @param id    The ID of the item type.
+     * @return A reference to the item.
+     */
+    Item& operator[](int id) noexcept;
+
+    /**
+     * @brief Accesses an item by its ID.
+     * @param id    The ID of the item type.
+     * @return A reference to the item.
+     */
+    Item const& operator[](int id) const noexcept;
+
+    /**
+     * @brief Updates every item across a regular step into the future.
+     * @param curr              The current moment before the step.
+     * @param round_info_view   The information about the turn just played.
+     * @param energy_inputs     The energy put into each item.
+     * @return The combined effects granted by the items for the next round.
+     * @see Item::Step
+     */
+    Effect Step(Moment curr, RoundInfoView const& round_info_view,
+                EnergyInputs const& energy_inputs);
+
+    /**
+     * @brief Updates every item while traveling to the past.
+     * @param curr          The current moment before branching.
+     * @param dest          The destination moment to reach.
+     * @return The combined effects granted by the items for the next round.
+     * @throws std::invalid_argument If the destination is not in the past.
+     * @see Item::Branch
+     */
+    Effect Branch(Moment curr, Moment dest);
+
+    /**
+     * @brief Duplicates the properties of every item at a moment.
+     * @param to_duplicate      The moment whose properties are duplicated.
+     * @throws std::out_of_range If no properties are stored for the moment.
+     */
+    void Duplicate(Moment to_duplicate);
+
+    /**
+     * @brief Duplicates properties captured from an earlier moment.
+     * @param handles           The handles of a row of the table of the
+     *      items, as obtained from @c ItemStateTable::HandlesAt.
+     * @param first_column      The column of the first item in the row.
+     */
+    void Duplicate(ItemStateTable::Handles const& handles, int first_column);
+
+    /**
+     * @brief Finalizes the changes in every item.
+     * @param new_moment        The moment to associate with item changes.
+     * @see Item::ConfirmPending
+     */
+    void ConfirmPending(Moment new_moment);
+
+    /**
+     * @brief Views the combined effects of the items at a moment.
+     * @param m     The moment to query.
+     * @return The effects granted by all the items at the moment.
+     */
+    Effect View(Moment m) const;
+
+    /**
+     * @brief Describes the state of every item at a moment.
+     * @param m     The moment to query.
+     * @return The tags of each item, in order of their ID's.
+     */
+    StateTagsArr State(Moment m) const;
+
+    /**
+     * @brief Earliest antitelephone destination any item could allow.
+     * @param m     The moment to query.
+     * @return The earliest time any item could allow, or
+     *      @c Item::kNoDestination if no item ever allows any destination.
+     */
+    int EarliestDestination(Moment m) const;
+
+  private:
+    // Declared in order of their ID's
+    Antitelephone antitelephone_;
+    Bridge bridge_;
+    Oracle oracle_;
+    Shield shield_;
+};
+}
+
+#endif //ITEM_SET_H
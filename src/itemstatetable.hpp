@@ -0,0 +1,485 @@
+#ifndef ITEM_STATE_TABLE_H
+#define ITEM_STATE_TABLE_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include <boost/serialization/vector.hpp>
+#include "moment.hpp"
+#include "retirementlog.hpp"
+#include "spillfile.hpp"
+#include "tieredmomentmap.hpp"
+#include "itemproperties.hpp"
+#include "propertiespool.hpp"
+
+namespace item {
+using Moment = timeplane::Moment;
+
+/**
+ * @brief The properties of a set of items at every moment.
+ *
+ * Each item owns one column of the table, and the properties of every
+ * column at one moment form a row. A game lays out its columns by player
+ * and then by item type.
+ *
+ * Most rounds leave most items unchanged, so a row only stores the
+ * columns that differ from the previous moment of the same timeline. A
+ * full row is stored every @c kKeyframeInterval moments and at the first
+ * moment each timeline owns, so a lookup replays a bounded number of rows.
+ * Retirements only ever remove the latest moments of a timeline, so the
+ * rows a remaining row depends on are never erased before it.
+ *
+ * Rows hold handles into a pool of the distinct properties, so comparing,
+ * copying and spilling properties only touches integers. References to
+ * properties remain valid for the lifetime of the table.
+ *
+ * The properties of a round are staged column by column, then committed
+ * to a moment or discarded in a single step.
+ */
+class ItemStateTable {
+  public:
+    /**
+     * @brief The properties of every column at one moment.
+     */
+    using Row = std::vector<ItemProperties>;
+
+    /**
+     * @brief The handles to the properties of every column at one moment.
+     */
+    using Handles = std::vector<PropertiesPool::Handle>;
+
+    /**
+     * @brief The largest number of consecutive rows of a timeline that
+     * only store their changes.
+     */
+    static int constexpr kKeyframeInterval = 16;
+
+    /**
+     * @brief Constructor.
+     * @param num_columns       The number of items in the table.
+     */
+    explicit ItemStateTable(int num_columns)
+        :num_columns_{num_columns},
+         pool_{},
+         rows_{},
+         staged_(num_columns, kNotStaged),
+         num_staged_{0} {}
+
+    /**
+     * @brief Accessor for the number of columns.
+     * @return The number of items in the table.
+     */
+    int num_columns() const noexcept {
+        return num_columns_;
+    }
+
+    /**
+     * @brief Accessor for the pool of distinct properties.
+     * @return The pool every row refers to.
+     */
+    PropertiesPool const& pool() const noexcept {
+        return pool_;
+    }
+
+    /**
+     * @brief Counts the rows stored for a moment.
+     * @param m     The moment to query.
+     * @return 1 if properties are stored for the moment, otherwise 0.
+     */
+    int count(Moment m) const noexcept {
+        return rows_.count(m);
+    }
+
+    /**
+     * @brief Rebuilds the properties of every column at a moment.
+     * @param m     The moment to query.
+     * @return The row of the moment.
+     * @throws std::out_of_range If no properties are stored for the moment.
+     * @throws std::runtime_error If a spilled row cannot be read back.
+     */
+    Row at(Moment m) const {
+        Row result;
+        result.reserve(num_columns_);
+        for (PropertiesPool::Handle handle: HandlesAt(m)) {
+            result.push_back(pool_.at(handle));
+        }
+        return result;
+    }
+
+    /**
+     * @brief Rebuilds the handles to the properties of every column at a
+     * moment.
+     *
+     * Unlike @c at, no properties are copied.
+     * @param m     The moment to query.
+     * @return The handles of the row of the moment, into @c pool.
+     * @throws std::out_of_range If no properties are stored for the moment.
+     * @throws std::runtime_error If a spilled row cannot be read back.
+     */
+    Handles HandlesAt(Moment m) const {
+        // Columns not found yet are marked like columns not staged
+        Handles result(num_columns_, kNotStaged);
+        int num_found = 0;
+        for (Entry const* entry = &rows_.at(m); num_found < num_columns_;
+                m = Previous(m), entry = &rows_.at(m)) {
+            for (Change const& change: entry->changes) {
+                if (result[change.column] == kNotStaged) {
+                    result[change.column] = change.handle;
+                    num_found++;
+                }
+            }
+            if (entry->depth == 0) {
+                break;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Accesses the properties of one column at a moment.
+     * @param m         The moment to query.
+     * @param column    The column of the item.
+     * @return A reference to the properties.
+     * @throws std::out_of_range If no properties are stored for the moment.
+     * @throws std::runtime_error If a spilled row cannot be read back.
+     */
+    ItemProperties const& at(Moment m, int column) const {
+        return pool_.at(HandleAt(m, column));
+    }
+
+    /**
+     * @brief Sets the properties of one column at a moment.
+     *
+     * The row of the moment is created on the first call, with every
+     * other column holding its properties at the previous moment of the
+     * timeline until it is set, or value-initialized if there is none.
+     * @param m             The moment to modify.
+     * @param column        The column of the item.
+     * @param properties    The properties to set.
+     * @throws std::logic_error If the row of the moment was already spilled,
+     *      or the next moment of the timeline already has a row.
+     */
+    void Set(Moment m, int column, ItemProperties const& properties) {
+        PropertiesPool::Handle handle = pool_.Intern(properties);
+        Entry entry = Draft(m);
+        Apply(entry, m, column, handle);
+        Store(m, std::move(entry));
+    }
+
+    /**
+     * @brief Accessor for the number of staged columns.
+     * @return The number of columns with properties waiting to be
+     *      committed.
+     */
+    int num_staged() const noexcept {
+        return num_staged_;
+    }
+
+    /**
+     * @brief Accessor for whether a column is staged.
+     * @param column    The column of the item.
+     * @return Whether the column has properties waiting to be committed.
+     */
+    bool IsStaged(int column) const noexcept {
+        return staged_[column] != kNotStaged;
+    }
+
+    /**
+     * @brief Stages the properties of one column for the next commit.
+     *
+     * Staging the same column again replaces the properties staged.
+     * @param column        The column of the item.
+     * @param properties    The properties to commit.
+     */
+    void Stage(int column, ItemProperties const& properties) {
+        Stage(column, pool_.Intern(properties));
+    }
+
+    /**
+     * @brief Stages properties already in the pool for the next commit.
+     *
+     * Staging the same column again replaces the properties staged.
+     * @param column        The column of the item.
+     * @param handle        The handle to the properties to commit, as
+     *      obtained from @c HandlesAt.
+     */
+    void Stage(int column, PropertiesPool::Handle handle) {
+        assert(handle != kNotStaged);
+        if (!IsStaged(column)) {
+            num_staged_++;
+        }
+        staged_[column] = handle;
+    }
+
+    /**
+     * @brief Sets every staged column at a moment in a single step.
+     *
+     * The new row is built aside and only replaces the stored one once
+     * every staged column is applied. Either every staged column is set
+     * and the staging buffer is cleared, or nothing changes. The previous
+     * row is rebuilt once, so the cost is linear in the number of columns
+     * and the changes replayed, whatever the number of staged columns.
+     * @param m     The moment to modify.
+     * @throws std::logic_error If the row of the moment was already spilled,
+     *      or the next moment of the timeline already has a row.
+     * @throws std::runtime_error If a spilled row cannot be read back.
+     */
+    void Commit(Moment m) {
+        Entry entry = Draft(m);
+        if (entry.depth == 0) {
+            for (int column = 0; column < num_columns_; column++) {
+                if (IsStaged(column)) {
+                    entry.changes[column].handle = staged_[column];
+                }
+            }
+        } else {
+            // The previous row is rebuilt once, then the changes are
+            // diffed against it in a single pass over the columns
+            Handles previous = HandlesAt(Previous(m));
+            std::vector<Change> changes;
+            auto stored = entry.changes.cbegin();
+            for (int column = 0; column < num_columns_; column++) {
+                PropertiesPool::Handle handle = previous[column];
+                if (stored != entry.changes.cend() &&
+                        stored->column == column) {
+                    handle = stored->handle;
+                    ++stored;
+                }
+                if (IsStaged(column)) {
+                    handle = staged_[column];
+                }
+                if (handle != previous[column]) {
+                    changes.push_back(Change{column, handle});
+                }
+            }
+            entry.changes.swap(changes);
+        }
+        Store(m, std::move(entry));
+        Discard();
+    }
+
+    /**
+     * @brief Sets one staged column at a moment.
+     *
+     * The other staged columns are left staged.
+     * @param m         The moment to modify.
+     * @param column    The column of the item, which must be staged.
+     * @throws std::logic_error If the row of the moment was already spilled,
+     *      or the next moment of the timeline already has a row.
+     * @throws std::runtime_error If a spilled row cannot be read back.
+     */
+    void Commit(Moment m, int column) {
+        assert(IsStaged(column));
+        Entry entry = Draft(m);
+        Apply(entry, m, column, staged_[column]);
+        Store(m, std::move(entry));
+        staged_[column] = kNotStaged;
+        num_staged_--;
+    }
+
+    /**
+     * @brief Discards every staged column without setting it.
+     */
+    void Discard() noexcept {
+        if (num_staged_ > 0) {
+            std::fill(staged_.begin(), staged_.end(), kNotStaged);
+            num_staged_ = 0;
+        }
+    }
+
+    /**
+     * @brief Erases the rows of every moment retired since an epoch.
+     * @param log       The log of retired moments.
+     * @param epoch     The epoch up to which rows were already erased.
+     * @return The number of rows erased.
+     */
+    int Reclaim(timeplane::RetirementLog const& log, int epoch) {
+        return rows_.Reclaim(log, epoch);
+    }
+
+    /**
+     * @brief Moves the rows of old moments out to a file.
+     *
+     * A timeline with a row at the given time keeps every row from the
+     * last full row at or before that time, so the rows from that time
+     * onward never read a spilled row back.
+     * @param file              The file to write the rows to, which must
+     *      outlive the instance.
+     * @param before_time       The rows of all moments before this time
+     *      are spilled, except the rows a later row depends on.
+     * @return The number of rows newly spilled.
+     * @throws std::runtime_error If a row cannot be written.
+     */
+    int Spill(timeplane::SpillFile& file, int before_time) {
+        // The time of the full row each row at the time depends on,
+        // indexed by timeline number
+        std::unordered_map<int, int> keep_from;
+        rows_.ForEachUnspilled([&] (Moment m, Entry const& entry) {
+            if (m.time() == before_time) {
+                keep_from.emplace(m.parent_timeline_num(),
+                                  before_time - entry.depth);
+            }
+        });
+        return rows_.SpillIf(file, [&] (Moment m) {
+            auto iter = keep_from.find(m.parent_timeline_num());
+            int end = iter == keep_from.end() ? before_time : iter->second;
+            return m.time() < end;
+        });
+    }
+
+    /**
+     * @brief Summarizes the memory used by the table.
+     *
+     * The cost is linear in the number of rows that were not spilled.
+     * @return The number of rows and the approximate bytes held for them.
+     */
+    timeplane::StoreUsage usage() const noexcept {
+        timeplane::StoreUsage result = rows_.usage();
+        result.bytes += pool_.memory_bytes();
+        rows_.ForEachUnspilled([&] (Moment, Entry const& entry) {
+            result.bytes += entry.changes.capacity() * sizeof(Change);
+        });
+        return result;
+    }
+
+  private:
+    /* The properties of one column */
+    struct Change {
+        int column;
+        PropertiesPool::Handle handle;
+
+        template<typename Archive>
+        void serialize(Archive& ar, unsigned int const) {
+            ar & column & handle;
+        }
+    };
+
+    /* The row of one moment */
+    struct Entry {
+        // The number of rows since the last full row, which is 0 for a
+        // full row
+        int depth;
+        // Every column of a full row, otherwise only the columns that
+        // changed since the previous moment, in order of columns
+        std::vector<Change> changes;
+
+        template<typename Archive>
+        void serialize(Archive& ar, unsigned int const) {
+            ar & depth & changes;
+        }
+    };
+
+    // Marks a column with nothing staged
+    enum : PropertiesPool::Handle {
+        kNotStaged = std::numeric_limits<PropertiesPool::Handle>::max()
+    };
+
+    int num_columns_;
+    PropertiesPool pool_;
+    timeplane::TieredMomentMap<Entry> rows_;
+    // The handles staged for the next commit, indexed by column
+    Handles staged_;
+    int num_staged_;
+
+    static Moment Previous(Moment m) noexcept {
+        return Moment{m.parent_timeline_num(), m.time() - 1};
+    }
+
+    static std::vector<Change>::iterator Lookup(Entry& entry, int column) {
+        return std::lower_bound(
+            entry.changes.begin(), entry.changes.end(), column,
+            [] (Change const& change, int c) { return change.column < c; });
+    }
+
+    static std::vector<Change>::const_iterator Lookup(Entry const& entry,
+                                                      int column) {
+        return std::lower_bound(
+            entry.changes.begin(), entry.changes.end(), column,
+            [] (Change const& change, int c) { return change.column < c; });
+    }
+
+    /* The handle to the properties of one column at a moment */
+    PropertiesPool::Handle HandleAt(Moment m, int column) const {
+        for (Entry const* entry = &rows_.at(m); ;
+                m = Previous(m), entry = &rows_.at(m)) {
+            if (entry->depth == 0) {
+                return entry->changes[column].handle;
+            }
+            auto iter = Lookup(*entry, column);
+            if (iter != entry->changes.end() && iter->column == column) {
+                return iter->handle;
+            }
+        }
+    }
+
+    /* A copy of the row of a moment to modify, or a new row */
+    Entry Draft(Moment m) {
+        Entry const* entry = rows_.FindUnspilled(m);
+        if (entry == nullptr && rows_.count(m) != 0) {
+            throw std::logic_error("Properties of the moment are spilled");
+        }
+        if (rows_.count(Moment{m.parent_timeline_num(), m.time() + 1}) != 0) {
+            throw std::logic_error(
+                "Properties of a later moment depend on the moment");
+        }
+        return entry != nullptr ? *entry : MakeEntry(m);
+    }
+
+    /* Replaces the row of a moment with a modified draft */
+    void Store(Moment m, Entry&& entry) {
+        Entry* stored = rows_.FindUnspilled(m);
+        if (stored == nullptr) {
+            rows_.emplace(m, std::move(entry));
+        } else {
+            stored->changes.swap(entry.changes);
+        }
+    }
+
+    /* Sets one column of a row, keeping only the changes of a delta */
+    void Apply(Entry& entry, Moment m, int column,
+               PropertiesPool::Handle handle) {
+        if (entry.depth == 0) {
+            entry.changes[column].handle = handle;
+            return;
+        }
+        auto iter = Lookup(entry, column);
+        bool stored = iter != entry.changes.end() && iter->column == column;
+        if (handle == HandleAt(Previous(m), column)) {
+            if (stored) {
+                entry.changes.erase(iter);
+            }
+        } else if (stored) {
+            iter->handle = handle;
+        } else {
+            entry.changes.insert(iter, Change{column, handle});
+        }
+    }
+
+    /* A row with no changes, or a full row when one is due */
+    Entry MakeEntry(Moment m) {
+        Moment previous = Previous(m);
+        if (rows_.count(previous) != 0) {
+            int depth = rows_.at(previous).depth + 1;
+            if (depth < kKeyframeInterval) {
+                return Entry{depth, {}};
+            }
+        }
+        Entry result{0, {}};
+        result.changes.reserve(num_columns_);
+        Handles handles = rows_.count(previous) != 0 ?
+                          HandlesAt(previous) :
+                          Handles(num_columns_,
+                                  pool_.Intern(ItemProperties{}));
+        for (int column = 0; column < num_columns_; column++) {
+            result.changes.push_back(Change{column, handles[column]});
+        }
+        return result;
+    }
+};
+}
+
+#endif //ITEM_STATE_TABLE_H
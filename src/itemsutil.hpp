@@ -16,17 +16,25 @@ namespace item {
 /**
  * @brief Constructs all the items in a vector in the order of their ID's.
  * @param first_moment      The first moment of the game.
+ * @param table             The table to store the properties of the items
+ *      in, or @c nullptr for each item to keep its own.
+ * @param player            The player owning the items, which selects
+ *      their columns in the table.
  * @return A vector containing a new instance of all the items.
  */
-inline ItemArr MakeItemPtrs(Moment first_moment) {
+inline ItemArr MakeItemPtrs(Moment first_moment,
+                            ItemStateTable* table = nullptr,
+                            int player = 0) {
     assert(ItemTypeID(ItemType::kAntitelephone) == 0);
     assert(ItemTypeID(ItemType::kBridge) == 1);
     assert(ItemTypeID(ItemType::kOracle) == 2);
     assert(ItemTypeID(ItemType::kShield) == 3);
-    return {std::make_unique<Antitelephone>(first_moment),
-            std::make_unique<Bridge>(first_moment),
-            std::make_unique<Oracle>(first_moment),
-            std::make_unique<Shield>(first_moment)};
+    int first_column = player * ItemTypeCount;
+    return {std::make_unique<Antitelephone>(first_moment, table,
+                                            first_column),
+            std::make_unique<Bridge>(first_moment, table, first_column + 1),
+            std::make_unique<Oracle>(first_moment, table, first_column + 2),
+            std::make_unique<Shield>(first_moment, table, first_column + 3)};
 }
 }
 
@@ -0,0 +1,89 @@
+#ifndef MEMORY_REPORT_H
+#define MEMORY_REPORT_H
+
+#include <vector>
+#include "tieredmomentmap.hpp"
+#include "timeline.hpp"
+
+namespace external {
+using StoreUsage = timeplane::StoreUsage;
+
+/**
+ * @brief A summary of the memory held by a game.
+ *
+ * Byte counts are approximate, and cover the storage of the containers
+ * rather than memory owned by the values they hold.
+ */
+struct MemoryReport {
+    /**
+     * @brief The segments of timelines holding moments.
+     */
+    std::vector<timeplane::TimeLine::Segment> segments;
+
+    /**
+     * @brief The total number of moments held by the segments.
+     */
+    int num_live_moments;
+
+    /**
+     * @brief The usage of the round information of every moment.
+     */
+    StoreUsage round_info;
+
+    /**
+     * @brief The usage of the moves stored for replaying past rounds.
+     */
+    StoreUsage moves_info;
+
+    /**
+     * @brief The usage of the snapshots of the game state kept to speed
+     * up time travel.
+     */
+    StoreUsage keyframes;
+
+    /**
+     * @brief The usage of the records of every moment shared with the
+     * snapshots of the game.
+     */
+    StoreUsage snapshot_records;
+
+    /**
+     * @brief The usage of the columnar history of every player.
+     */
+    StoreUsage player_history;
+
+    /**
+     * @brief The usage of the moves submitted for the upcoming round.
+     */
+    StoreUsage moves_pending;
+
+    /**
+     * @brief The usage of the table holding the properties of every item.
+     */
+    StoreUsage item_states;
+
+    /**
+     * @brief The number of moments retired so far.
+     */
+    int num_retired;
+
+    /**
+     * @brief The number of entries erased from every store because their
+     * moments were retired.
+     */
+    int num_reclaimed;
+
+    /**
+     * @brief The number of stored moves erased because they could never
+     * be replayed.
+     */
+    int num_pruned;
+
+    /**
+     * @brief The number of bytes written to the spill file, if any.
+     */
+    long spill_file_bytes;
+};
+}
+
+#endif //MEMORY_REPORT_H
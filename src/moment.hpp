@@ -2,11 +2,20 @@
 #define MOMENT_H
 
 #include <cassert>
+#include <cstdint>
 #include <functional>
 #include <boost/serialization/access.hpp>
 
 namespace timeplane {
 
+/**
+ * @brief A @c Moment packed into a single 64-bit integer.
+ *
+ * The timeline number occupies the upper half and the time occupies the
+ * lower half, so keys of the same timeline are ordered by time.
+ */
+using MomentKey = std::uint64_t;
+
 /**
  * @brief A unique moment in a @c TimePlane.
  *
@@ -55,6 +64,28 @@ class Moment {
         return time_;
     }
 
+    /**
+     * @brief Packs the moment into a single integer.
+     *
+     * @return The key uniquely identifying the moment.
+     */
+    MomentKey key() const noexcept {
+        return (static_cast<MomentKey>(
+                    static_cast<std::uint32_t>(parent_timeline_num_)) << 32) |
+               static_cast<std::uint32_t>(time_);
+    }
+
+    /**
+     * @brief Unpacks a moment from its key.
+     *
+     * @param key       A key obtained from @c key().
+     * @return The moment identified by the key.
+     */
+    static Moment FromKey(MomentKey key) noexcept {
+        return Moment{static_cast<int>(static_cast<std::uint32_t>(key >> 32)),
+                      static_cast<int>(static_cast<std::uint32_t>(key))};
+    }
+
     /**
      * @brief Equality operator.
      *
@@ -94,7 +125,6 @@ class Moment {
 
   private:
     friend class boost::serialization::access;
-    friend struct std::hash<Moment>;
 
     int parent_timeline_num_;
     int time_;
@@ -108,9 +138,9 @@ template <>
  */
 struct hash<timeplane::Moment> {
     size_t operator()(timeplane::Moment const& m) const {
-        size_t v0 = std::hash<int> {} (m.parent_timeline_num_);
-        size_t v1 = std::hash<int> {} (m.time_);
-        return (v0 * 3) ^ v1;
+        // Fibonacci hashing spreads both halves of the key over the result
+        std::uint64_t mixed = m.key() * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(mixed ^ (mixed >> 32));
     }
 };
 }
@@ -0,0 +1,274 @@
+#ifndef MOMENT_FEED_H
+#define MOMENT_FEED_H
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include "moment.hpp"
+#include "roundinfo.hpp"
+#include "aliases.hpp"
+
+namespace external {
+using Moment = timeplane::Moment;
+using PlayerMask = roundinfo::PlayerMask;
+
+/**
+ * @brief A compact, fixed-size record of a newly created moment.
+ *
+ * The record holds the round information of the moment as seen by an
+ * omniscient viewer, and can be copied as raw bytes.
+ */
+struct MomentEvent {
+    /**
+     * @brief The largest number of players a record can describe.
+     */
+    static int constexpr kMaxPlayers = 6;
+
+    /**
+     * @brief The moment that was created.
+     */
+    Moment moment;
+
+    /**
+     * @brief Whether the moment is the first of a new timeline.
+     */
+    bool new_timeline;
+
+    /**
+     * @brief The number of players in the game.
+     */
+    int num_players;
+
+    /**
+     * @brief The location of each player.
+     */
+    std::array<int, kMaxPlayers> location;
+
+    /**
+     * @brief The health each player has remaining.
+     */
+    std::array<int, kMaxPlayers> health_remaining;
+
+    /**
+     * @brief The damage received by each player.
+     */
+    std::array<int, kMaxPlayers> damage_received;
+
+    /**
+     * @brief The set of active players.
+     */
+    PlayerMask active;
+
+    /**
+     * @brief The set of allies of each player.
+     */
+    std::array<PlayerMask, kMaxPlayers> allies;
+
+    /**
+     * @brief Creates a record from the round information of a moment.
+     * @param m                 The moment that was created.
+     * @param new_timeline      Whether the moment begins a new timeline.
+     * @param info              The round information of the moment.
+     * @return The record describing the moment.
+     */
+    static MomentEvent FromRoundInfo(Moment m, bool new_timeline,
+                                     roundinfo::RoundInfo const& info) {
+        int constexpr omnv = roundinfo::RoundInfo::kOmniscientViewer;
+        assert(info.num_players() <= kMaxPlayers);
+        MomentEvent result{m, new_timeline, info.num_players(),
+                           {}, {}, {}, 0, {}};
+        for (int player = 0; player < info.num_players(); player++) {
+            result.location[player] = info.Location(player, omnv);
+            result.health_remaining[player] =
+                info.HealthRemaining(player, omnv);
+            result.damage_received[player] =
+                info.DamageReceived(player, omnv);
+            if (info.Active(player)) {
+                result.active |= PlayerMask{1} << player;
+            }
+            for (int other = 0; other < info.num_players(); other++) {
+                if (info.alliance_data().Value(player, other)) {
+                    result.allies[player] |= PlayerMask{1} << other;
+                }
+            }
+        }
+        return result;
+    }
+};
+
+/**
+ * @brief A lock-free ring of the latest moments created in a game.
+ *
+ * A single writer publishes each new moment, and any number of readers on
+ * other threads follow along through their own @c Reader. Neither side
+ * ever blocks: the writer overwrites the oldest records without waiting,
+ * and a reader that falls more than a full ring behind skips the records
+ * it missed. Each slot carries a sequence number that is odd while the
+ * slot is being written, so readers detect and discard torn copies.
+ */
+class MomentFeed {
+  public:
+    /**
+     * @brief A cursor through the records of a feed, owned by one thread.
+     */
+    class Reader {
+      public:
+        /**
+         * @brief Constructor.
+         *
+         * The reader starts after the latest record already published.
+         * @param feed      The feed to read, which must outlive the reader.
+         */
+        explicit Reader(MomentFeed const& feed) noexcept
+            :feed_{&feed},
+             next_{feed.num_published()},
+             num_missed_{0} {}
+
+        /**
+         * @brief Accessor for the number of records skipped.
+         * @return The number of records overwritten before they were read.
+         */
+        std::uint64_t num_missed() const noexcept {
+            return num_missed_;
+        }
+
+        /**
+         * @brief Reads the next record, if any has been published.
+         * @param event     The instance to copy the record into.
+         * @return Whether a record was read.
+         */
+        bool TryNext(MomentEvent& event) noexcept {
+            std::uint64_t const capacity = feed_->capacity_;
+            while (true) {
+                std::uint64_t head =
+                    feed_->head_.load(std::memory_order_acquire);
+                if (next_ == head) {
+                    return false;
+                }
+                if (head - next_ > capacity) {
+                    num_missed_ += head - capacity - next_;
+                    next_ = head - capacity;
+                }
+                Slot const& slot = feed_->slots_[next_ % capacity];
+                std::uint64_t sequence =
+                    slot.sequence.load(std::memory_order_acquire);
+                Words words;
+                for (std::size_t i = 0; i < kNumWords; i++) {
+                    words[i] = slot.words[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence != Completed(next_) ||
+                        slot.sequence.load(std::memory_order_relaxed) !=
+                        sequence) {
+                    // The writer has come around and is reusing the slot
+                    num_missed_++;
+                    next_++;
+                    continue;
+                }
+                // The record is trivially copyable, but not trivial
+                std::memcpy(static_cast<void*>(&event), words.data(),
+                            sizeof(MomentEvent));
+                next_++;
+                return true;
+            }
+        }
+
+      private:
+        MomentFeed const* feed_;
+        std::uint64_t next_;
+        std::uint64_t num_missed_;
+    };
+
+    /**
+     * @brief Constructor.
+     * @param capacity      The number of records kept for slow readers.
+     */
+    explicit MomentFeed(int capacity)
+        :slots_{new Slot[capacity]},
+         capacity_{static_cast<std::uint64_t>(capacity)},
+         head_{0} {
+        assert(capacity > 0);
+        for (int i = 0; i < capacity; i++) {
+            slots_[i].sequence.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    MomentFeed(MomentFeed const&) = delete;
+    MomentFeed& operator=(MomentFeed const&) = delete;
+
+    /**
+     * @brief Accessor for the number of records kept.
+     * @return The number of records a reader may fall behind by before
+     *      skipping any.
+     */
+    int capacity() const noexcept {
+        return static_cast<int>(capacity_);
+    }
+
+    /**
+     * @brief Accessor for the number of records published.
+     * @return The number of records published since construction.
+     */
+    std::uint64_t num_published() const noexcept {
+        return head_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Starts following the feed.
+     * @return A reader that will see every record published from now on.
+     */
+    Reader Subscribe() const noexcept {
+        return Reader{*this};
+    }
+
+    /**
+     * @brief Publishes a record, overwriting the oldest one if needed.
+     *
+     * Only one thread may publish to a feed.
+     * @param event     The record to publish.
+     */
+    void Publish(MomentEvent const& event) noexcept {
+        std::uint64_t index = head_.load(std::memory_order_relaxed);
+        Slot& slot = slots_[index % capacity_];
+        Words words{};
+        std::memcpy(words.data(), &event, sizeof(MomentEvent));
+        slot.sequence.store(Completed(index) - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < kNumWords; i++) {
+            slot.words[i].store(words[i], std::memory_order_relaxed);
+        }
+        slot.sequence.store(Completed(index), std::memory_order_release);
+        head_.store(index + 1, std::memory_order_release);
+    }
+
+  private:
+    static_assert(std::is_trivially_copyable<MomentEvent>::value,
+                  "Records are copied as raw bytes");
+
+    static std::size_t constexpr kNumWords =
+        (sizeof(MomentEvent) + sizeof(std::uint64_t) - 1) /
+        sizeof(std::uint64_t);
+
+    using Words = std::array<std::uint64_t, kNumWords>;
+
+    struct Slot {
+        std::atomic<std::uint64_t> sequence;
+        std::array<std::atomic<std::uint64_t>, kNumWords> words;
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    std::uint64_t capacity_;
+    std::atomic<std::uint64_t> head_;
+
+    /* The even sequence number of a slot once a record is written */
+    static std::uint64_t Completed(std::uint64_t index) noexcept {
+        return 2 * index + 2;
+    }
+};
+}
+
+#endif //MOMENT_FEED_H
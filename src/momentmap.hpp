@@ -0,0 +1,410 @@
+#ifndef MOMENT_MAP_H
+#define MOMENT_MAP_H
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "moment.hpp"
+#include "aliases.hpp"
+#include "retirementlog.hpp"
+
+namespace timeplane {
+
+/**
+ * @brief An associative container from @c Moment instances to values.
+ *
+ * The container uses open addressing with linear probing over flat arrays,
+ * where the keys are stored separately from the values so that probing
+ * only touches the keys. Each moment is stored as its packed
+ * @c MomentKey. Erasing shifts later entries back instead of leaving
+ * tombstones, so lookups never slow down as moments come and go.
+ *
+ * Pointers to values are invalidated by any insertion or erasure.
+ * @tparam T        The type of the values stored.
+ */
+template <typename T>
+class MomentMap {
+  public:
+    /**
+     * @brief Default constructor.
+     *
+     * No memory is allocated until the first insertion.
+     */
+    MomentMap() noexcept
+        :keys_{},
+         values_{},
+         capacity_{0},
+         size_{0} {}
+
+    ~MomentMap() {
+        clear();
+    }
+
+    MomentMap(MomentMap&& rhs) noexcept
+        :MomentMap{} {
+        swap(rhs);
+    }
+
+    MomentMap& operator=(MomentMap&& rhs) noexcept {
+        MomentMap temp{std::move(rhs)};
+        swap(temp);
+        return *this;
+    }
+
+    MomentMap(MomentMap const&) = delete;
+    MomentMap& operator=(MomentMap const&) = delete;
+
+    /**
+     * @brief Accessor for the number of entries.
+     * @return The number of moments with a stored value.
+     */
+    int size() const noexcept {
+        return size_;
+    }
+
+    /**
+     * @brief Accessor for whether the container is empty.
+     * @return Whether no values are stored.
+     */
+    bool empty() const noexcept {
+        return size_ == 0;
+    }
+
+    /**
+     * @brief Accessor for the number of slots allocated.
+     * @return The number of entries that fit before the next reallocation,
+     *      including empty slots kept to shorten probing.
+     */
+    int capacity() const noexcept {
+        return capacity_;
+    }
+
+    /**
+     * @brief Accessor for the memory held by the slots.
+     * @return The number of bytes allocated for keys and values, not
+     *      counting any memory owned by the values themselves.
+     */
+    std::size_t memory_bytes() const noexcept {
+        return static_cast<std::size_t>(capacity_) *
+               (sizeof(MomentKey) + sizeof(Storage));
+    }
+
+    /**
+     * @brief Finds the value associated with a moment.
+     * @param m     The moment to query.
+     * @return A pointer to the value, or @c nullptr if there is none.
+     */
+    T const* Find(Moment m) const noexcept {
+        int slot = FindSlot(m.key());
+        if (slot == kNoSlot) {
+            return nullptr;
+        }
+        return Value(slot);
+    }
+
+    /**
+     * @brief Finds the value associated with a moment.
+     * @param m     The moment to query.
+     * @return A pointer to the value, or @c nullptr if there is none.
+     */
+    T* Find(Moment m) noexcept {
+        return const_cast<T*>(static_cast<MomentMap const&>(*this).Find(m));
+    }
+
+    /**
+     * @brief Accesses the value associated with a moment.
+     * @param m     The moment to query.
+     * @return A reference to the value.
+     * @throws std::out_of_range If no value is stored for the moment.
+     */
+    T const& at(Moment m) const {
+        T const* result = Find(m);
+        if (result == nullptr) {
+            throw std::out_of_range("No value stored for the moment.");
+        }
+        return *result;
+    }
+
+    /**
+     * @brief Accesses the value associated with a moment.
+     * @param m     The moment to query.
+     * @return A reference to the value.
+     * @throws std::out_of_range If no value is stored for the moment.
+     */
+    T& at(Moment m) {
+        return const_cast<T&>(static_cast<MomentMap const&>(*this).at(m));
+    }
+
+    /**
+     * @brief Counts the values associated with a moment.
+     * @param m     The moment to query.
+     * @return 1 if a value is stored for the moment, otherwise 0.
+     */
+    int count(Moment m) const noexcept {
+        return FindSlot(m.key()) == kNoSlot ? 0 : 1;
+    }
+
+    /**
+     * @brief Constructs a value for a moment if there is none yet.
+     * @param m         The moment to associate with the value.
+     * @param args      The arguments to construct the value from.
+     * @return Whether a new value was inserted.
+     */
+    template <typename... Args>
+    bool emplace(Moment m, Args&&... args) {
+        MomentKey key = m.key();
+        assert(key != kEmptyKey);
+        if (FindSlot(key) != kNoSlot) {
+            return false;
+        }
+        if ((size_ + 1) * kMaxLoadDenominator >
+                capacity_ * kMaxLoadNumerator) {
+            Rehash(capacity_ == 0 ? kMinCapacity : capacity_ * 2);
+        }
+        int slot = ProbeStart(key);
+        while (keys_[slot] != kEmptyKey) {
+            slot = (slot + 1) & (capacity_ - 1);
+        }
+        new (Value(slot)) T(std::forward<Args>(args)...);
+        keys_[slot] = key;
+        size_++;
+        return true;
+    }
+
+    /**
+     * @brief Erases the value associated with a moment.
+     * @param m     The moment whose value is erased.
+     * @return The number of values erased, which is either 0 or 1.
+     */
+    int erase(Moment m) noexcept {
+        int slot = FindSlot(m.key());
+        if (slot == kNoSlot) {
+            return 0;
+        }
+        EraseSlot(slot);
+        return 1;
+    }
+
+    /**
+     * @brief Erases the values associated with a range of moments.
+     * @param iterators     A pair of iterators denoting the moments.
+     * @return The number of values erased.
+     */
+    int erase(MomentIterators iterators) noexcept {
+        int result = 0;
+        for (auto iter = iterators.first; iter != iterators.second; ++iter) {
+            result += erase(*iter);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Erases the values of every moment retired since an epoch.
+     *
+     * If many values are retired, the entries are swept in a single pass
+     * and the slots are reallocated to fit the values that remain.
+     * Otherwise, only the retired moments themselves are looked up.
+     * @param log       The log of retired moments.
+     * @param epoch     The epoch up to which values were already reclaimed.
+     * @return The number of values erased.
+     */
+    int Reclaim(RetirementLog const& log, int epoch) {
+        int retired = log.RetiredSince(epoch);
+        if (retired == 0 || size_ == 0) {
+            return 0;
+        }
+        int old_size = size_;
+        if (retired * kSweepRatio >= size_) {
+            Sweep(log);
+        } else {
+            for (; epoch < log.epoch(); epoch++) {
+                RetirementLog::Retirement const& r = log.at(epoch);
+                for (int time = r.begin_time; time < r.end_time; time++) {
+                    erase(Moment{r.timeline_num, time});
+                }
+            }
+        }
+        return old_size - size_;
+    }
+
+    /**
+     * @brief Erases every value.
+     *
+     * The allocated slots are kept for reuse.
+     */
+    void clear() noexcept {
+        for (int slot = 0; slot < capacity_ && size_ > 0; slot++) {
+            if (keys_[slot] != kEmptyKey) {
+                Value(slot)->~T();
+                keys_[slot] = kEmptyKey;
+                size_--;
+            }
+        }
+    }
+
+    /**
+     * @brief Allocates enough slots for the specified number of entries.
+     * @param num_entries       The number of entries to make room for.
+     */
+    void reserve(int num_entries) {
+        int capacity = capacity_ == 0 ? kMinCapacity : capacity_;
+        while (num_entries * kMaxLoadDenominator >
+                capacity * kMaxLoadNumerator) {
+            capacity *= 2;
+        }
+        if (capacity != capacity_) {
+            Rehash(capacity);
+        }
+    }
+
+    /**
+     * @brief Calls a function on every entry, in no particular order.
+     * @tparam Fn       A function taking a @c Moment and a value reference.
+     * @param fn        The function to call.
+     */
+    template <typename Fn>
+    void ForEach(Fn&& fn) const {
+        for (int slot = 0; slot < capacity_; slot++) {
+            if (keys_[slot] != kEmptyKey) {
+                fn(Moment::FromKey(keys_[slot]),
+                   static_cast<T const&>(*Value(slot)));
+            }
+        }
+    }
+
+    /**
+     * @brief Swaps the contents with another instance.
+     * @param rhs       The instance to swap with.
+     */
+    void swap(MomentMap& rhs) noexcept {
+        std::swap(keys_, rhs.keys_);
+        std::swap(values_, rhs.values_);
+        std::swap(capacity_, rhs.capacity_);
+        std::swap(size_, rhs.size_);
+    }
+
+  private:
+    using Storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+    // The key of Moment{-1, -1}, which is never a valid moment
+    static MomentKey constexpr kEmptyKey = ~MomentKey{0};
+    static int constexpr kNoSlot = -1;
+    static int constexpr kMinCapacity = 16;
+    static int constexpr kMaxLoadNumerator = 3;
+    static int constexpr kMaxLoadDenominator = 4;
+    // Sweeping pays off once this fraction of the values are retired
+    static int constexpr kSweepRatio = 4;
+
+    std::unique_ptr<MomentKey[]> keys_;
+    std::unique_ptr<Storage[]> values_;
+    int capacity_; // Always zero or a power of 2
+    int size_;
+
+    T* Value(int slot) const noexcept {
+        return reinterpret_cast<T*>(&values_[slot]);
+    }
+
+    // Fibonacci hashing, taking the high bits as the slot
+    int ProbeStart(MomentKey key) const noexcept {
+        MomentKey mixed = key * 0x9E3779B97F4A7C15ULL;
+        return static_cast<int>((mixed >> 32) & (capacity_ - 1));
+    }
+
+    int FindSlot(MomentKey key) const noexcept {
+        if (capacity_ == 0) {
+            return kNoSlot;
+        }
+        int slot = ProbeStart(key);
+        while (keys_[slot] != kEmptyKey) {
+            if (keys_[slot] == key) {
+                return slot;
+            }
+            slot = (slot + 1) & (capacity_ - 1);
+        }
+        return kNoSlot;
+    }
+
+    // Backward shift deletion keeps every probe sequence unbroken
+    void EraseSlot(int slot) noexcept {
+        int mask = capacity_ - 1;
+        Value(slot)->~T();
+        int hole = slot;
+        int next = (slot + 1) & mask;
+        while (keys_[next] != kEmptyKey) {
+            int home = ProbeStart(keys_[next]);
+            // Move the entry back if the hole lies within its probe sequence
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                new (Value(hole)) T(std::move(*Value(next)));
+                Value(next)->~T();
+                keys_[hole] = keys_[next];
+                hole = next;
+            }
+            next = (next + 1) & mask;
+        }
+        keys_[hole] = kEmptyKey;
+        size_--;
+    }
+
+    // Keeps only the values of moments that have not been retired
+    void Sweep(RetirementLog const& log) {
+        int remaining = 0;
+        for (int slot = 0; slot < capacity_; slot++) {
+            if (keys_[slot] != kEmptyKey &&
+                    !log.IsRetired(Moment::FromKey(keys_[slot]))) {
+                remaining++;
+            }
+        }
+        int new_capacity = kMinCapacity;
+        while (remaining * kMaxLoadDenominator >
+                new_capacity * kMaxLoadNumerator) {
+            new_capacity *= 2;
+        }
+        MomentMap result{};
+        result.Allocate(new_capacity);
+        for (int slot = 0; slot < capacity_; slot++) {
+            if (keys_[slot] != kEmptyKey &&
+                    !log.IsRetired(Moment::FromKey(keys_[slot]))) {
+                result.MoveIn(keys_[slot], std::move(*Value(slot)));
+            }
+        }
+        swap(result);
+    }
+
+    void Allocate(int new_capacity) {
+        keys_.reset(new MomentKey[new_capacity]);
+        values_.reset(new Storage[new_capacity]);
+        capacity_ = new_capacity;
+        for (int slot = 0; slot < new_capacity; slot++) {
+            keys_[slot] = kEmptyKey;
+        }
+    }
+
+    // Inserts a key known to be absent, without growing the slots
+    void MoveIn(MomentKey key, T&& value) {
+        int slot = ProbeStart(key);
+        while (keys_[slot] != kEmptyKey) {
+            slot = (slot + 1) & (capacity_ - 1);
+        }
+        new (Value(slot)) T(std::move(value));
+        keys_[slot] = key;
+        size_++;
+    }
+
+    void Rehash(int new_capacity) {
+        MomentMap result{};
+        result.Allocate(new_capacity);
+        for (int slot = 0; slot < capacity_; slot++) {
+            if (keys_[slot] != kEmptyKey) {
+                result.MoveIn(keys_[slot], std::move(*Value(slot)));
+            }
+        }
+        swap(result);
+    }
+};
+}
+
+#endif //MOMENT_MAP_H
@@ -6,12 +6,17 @@
 #include <type_traits>
 #include <boost/serialization/access.hpp>
 #include <boost/serialization/array.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/string.hpp>
 #include <boost/serialization/utility.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
 #include "moment.hpp"
 #include "effect.hpp"
 #include "itemproperties.hpp"
 #include "itemtype.hpp"
 #include "roundinfoview.hpp"
+#include "statetags.hpp"
 #include "aliases.hpp"
 
 namespace external {
@@ -31,6 +36,11 @@ class MomentOverview {
   public:
     using TaggedValuesArr = std::array<TaggedValues, item::ItemTypeCount>;
 
+    /**
+     * @brief The structured state of each item, in order of their ID's.
+     */
+    using StateTagsArr = std::array<item::StateTags, item::ItemTypeCount>;
+
     /**
      * @brief Default constructor.
      *
@@ -49,7 +59,7 @@ class MomentOverview {
      * @param round_info_           Information about the round.
      */
     MomentOverview(Moment moment, Effect effect,
-                   TaggedValuesArr item_state_data, RoundInfoView round_info)
+                   StateTagsArr item_state_data, RoundInfoView round_info)
         :moment_{moment},
          effect_{effect},
          item_state_data_{std::move(item_state_data)},
@@ -83,11 +93,22 @@ class MomentOverview {
 
     /**
      * @brief Accessor for the state of an item.
+     *
+     * The strings are only produced when this is called.
      * @param itemID        The item queried.
      * @return A group of tagged values that offer a user-friendly view
      *      into the internal state of the item.
      */
-    TaggedValues const& ItemState(int itemID) const noexcept {
+    TaggedValues ItemState(int itemID) const {
+        return item::FormatStateTags(item_state_data_[itemID]);
+    }
+
+    /**
+     * @brief Accessor for the structured state of an item.
+     * @param itemID        The item queried.
+     * @return The tags describing the state of the item.
+     */
+    item::StateTags const& ItemStateTags(int itemID) const noexcept {
         return item_state_data_[itemID];
     }
 
@@ -100,25 +121,55 @@ class MomentOverview {
     }
 
     /**
-     * @brief Serialization function.
+     * @brief Serialization function for saving.
      *
      * @tparam Archive      The serialization archive type.
      * @param ar            The serialization archive.
      * @param version       The verion of the serialization protocol to use.
      */
     template <typename Archive>
-    void serialize(Archive& ar, unsigned int const version) {
+    void save(Archive& ar, unsigned int const version) const {
         (void)version;
-        assert(version == 0);
         ar & moment_ & effect_ & item_state_data_ & round_info_;
     }
 
+    /**
+     * @brief Serialization function for loading.
+     *
+     * Version 0 stored the item states as tagged strings, which are parsed
+     * back into tags.
+     * @tparam Archive      The serialization archive type.
+     * @param ar            The serialization archive.
+     * @param version       The verion of the serialization protocol to use.
+     * @throws std::invalid_argument If a version 0 item state is not
+     *      recognized.
+     */
+    template <typename Archive>
+    void load(Archive& ar, unsigned int const version) {
+        assert(version <= 1);
+        ar & moment_ & effect_;
+        if (version == 0) {
+            TaggedValuesArr item_state_data;
+            ar & item_state_data;
+            for (int i = 0; i < item::ItemTypeCount; i++) {
+                item_state_data_[i] = item::ParseStateTags(item_state_data[i]);
+            }
+        } else {
+            ar & item_state_data_;
+        }
+        ar & round_info_;
+    }
+
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
   private:
     Moment moment_;
     Effect effect_;
-    TaggedValuesArr item_state_data_;
+    StateTagsArr item_state_data_;
     RoundInfoView round_info_;
 };
 }
 
+BOOST_CLASS_VERSION(external::MomentOverview, 1)
+
 #endif //MOMENT_OVERVIEW_H
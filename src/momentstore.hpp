@@ -0,0 +1,273 @@
+#ifndef MOMENT_STORE_H
+#define MOMENT_STORE_H
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "moment.hpp"
+
+namespace timeplane {
+
+/**
+ * @brief A sequence of @c Moment instances stored in fixed-size blocks.
+ *
+ * Moments are only ever added to the end or removed from the end. Unlike
+ * a vector, the instance never relocates a stored moment, so pointers and
+ * references to stored moments remain valid until the moment is erased.
+ * Erasing moments releases every block that becomes empty.
+ */
+class MomentStore {
+  public:
+    /**
+     * @brief Number of moments in each block.
+     */
+    static int constexpr kBlockSize = 32;
+
+    /**
+     * @brief A random access iterator to constant moments in the store.
+     *
+     * The iterator is invalidated if the moment it refers to is erased.
+     */
+    class const_iterator {
+      public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = Moment;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Moment const*;
+        using reference = Moment const&;
+
+        const_iterator() noexcept
+            :store_{nullptr},
+             pos_{0} {}
+
+        const_iterator(MomentStore const* store, int pos) noexcept
+            :store_{store},
+             pos_{pos} {}
+
+        reference operator*() const {
+            return (*store_)[pos_];
+        }
+
+        pointer operator->() const {
+            return &(*store_)[pos_];
+        }
+
+        reference operator[](difference_type n) const {
+            return (*store_)[pos_ + static_cast<int>(n)];
+        }
+
+        const_iterator& operator++() noexcept {
+            pos_++;
+            return *this;
+        }
+
+        const_iterator operator++(int) noexcept {
+            const_iterator result = *this;
+            pos_++;
+            return result;
+        }
+
+        const_iterator& operator--() noexcept {
+            pos_--;
+            return *this;
+        }
+
+        const_iterator operator--(int) noexcept {
+            const_iterator result = *this;
+            pos_--;
+            return result;
+        }
+
+        const_iterator& operator+=(difference_type n) noexcept {
+            pos_ += static_cast<int>(n);
+            return *this;
+        }
+
+        const_iterator& operator-=(difference_type n) noexcept {
+            pos_ -= static_cast<int>(n);
+            return *this;
+        }
+
+        const_iterator operator+(difference_type n) const noexcept {
+            return const_iterator{store_, pos_ + static_cast<int>(n)};
+        }
+
+        const_iterator operator-(difference_type n) const noexcept {
+            return const_iterator{store_, pos_ - static_cast<int>(n)};
+        }
+
+        difference_type operator-(const_iterator const& rhs) const noexcept {
+            return pos_ - rhs.pos_;
+        }
+
+        bool operator==(const_iterator const& rhs) const noexcept {
+            return pos_ == rhs.pos_ && store_ == rhs.store_;
+        }
+
+        bool operator!=(const_iterator const& rhs) const noexcept {
+            return !(operator==(rhs));
+        }
+
+        bool operator<(const_iterator const& rhs) const noexcept {
+            return pos_ < rhs.pos_;
+        }
+
+        bool operator>(const_iterator const& rhs) const noexcept {
+            return pos_ > rhs.pos_;
+        }
+
+        bool operator<=(const_iterator const& rhs) const noexcept {
+            return pos_ <= rhs.pos_;
+        }
+
+        bool operator>=(const_iterator const& rhs) const noexcept {
+            return pos_ >= rhs.pos_;
+        }
+
+      private:
+        MomentStore const* store_;
+        int pos_;
+    };
+
+    /**
+     * @brief Default constructor.
+     *
+     * The store is initially empty and holds no blocks.
+     */
+    MomentStore() noexcept
+        :blocks_(),
+         size_{0} {}
+
+    /**
+     * @brief Accessor for the number of moments stored.
+     * @return The number of moments stored.
+     */
+    int size() const noexcept {
+        return size_;
+    }
+
+    /**
+     * @brief Accessor for whether the store is empty.
+     * @return Whether no moments are stored.
+     */
+    bool empty() const noexcept {
+        return size_ == 0;
+    }
+
+    /**
+     * @brief Accessor for the number of blocks held.
+     * @return The number of blocks currently allocated.
+     */
+    int num_blocks() const noexcept {
+        return static_cast<int>(blocks_.size());
+    }
+
+    /**
+     * @brief Accesses a stored moment without bounds checking.
+     * @param pos       The position of the moment.
+     * @return A reference to the moment, which stays valid until
+     *      the moment is erased.
+     */
+    Moment const& operator[](int pos) const noexcept {
+        return (*blocks_[pos / kBlockSize])[pos % kBlockSize];
+    }
+
+    /**
+     * @brief Accesses a stored moment.
+     * @param pos       The position of the moment.
+     * @return A reference to the moment, which stays valid until
+     *      the moment is erased.
+     * @throws std::out_of_range If no moment is stored at the position.
+     */
+    Moment const& at(int pos) const {
+        if (pos < 0 || pos >= size_) {
+            throw std::out_of_range("Moment position is not valid.");
+        }
+        return operator[](pos);
+    }
+
+    /**
+     * @brief Accesses the last stored moment.
+     *
+     * The store must not be empty.
+     * @return A reference to the last moment.
+     */
+    Moment const& back() const noexcept {
+        return operator[](size_ - 1);
+    }
+
+    /**
+     * @brief Adds a moment to the end of the store.
+     *
+     * A new block is allocated only when the last block is full.
+     * @param m     The moment to add.
+     */
+    void push_back(Moment m) {
+        if (size_ == num_blocks() * kBlockSize) {
+            blocks_.push_back(std::make_unique<Block>());
+        }
+        (*blocks_[size_ / kBlockSize])[size_ % kBlockSize] = m;
+        size_++;
+    }
+
+    /**
+     * @brief Erases all moments from the specified position onward.
+     *
+     * Blocks that no longer hold any moments are released.
+     * @param pos       The position of the first moment to erase.
+     */
+    void EraseFrom(int pos) {
+        if (pos >= size_) {
+            return;
+        }
+        size_ = pos;
+        blocks_.resize((pos + kBlockSize - 1) / kBlockSize);
+    }
+
+    /**
+     * @brief Iterator to the first stored moment.
+     * @return A constant iterator to the beginning of the store.
+     */
+    const_iterator cbegin() const noexcept {
+        return const_iterator{this, 0};
+    }
+
+    /**
+     * @brief Iterator past the last stored moment.
+     * @return A constant iterator to the end of the store.
+     */
+    const_iterator cend() const noexcept {
+        return const_iterator{this, size_};
+    }
+
+    /**
+     * @brief Iterator to the first stored moment.
+     * @return A constant iterator to the beginning of the store.
+     */
+    const_iterator begin() const noexcept {
+        return cbegin();
+    }
+
+    /**
+     * @brief Iterator past the last stored moment.
+     * @return A constant iterator to the end of the store.
+     */
+    const_iterator end() const noexcept {
+        return cend();
+    }
+
+    MomentStore(MomentStore const&) = delete;
+    MomentStore& operator=(MomentStore const&) = delete;
+
+  private:
+    using Block = std::array<Moment, kBlockSize>;
+
+    std::vector<std::unique_ptr<Block>> blocks_;
+    int size_;
+};
+}
+
+#endif //MOMENT_STORE_H
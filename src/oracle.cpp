@@ -5,8 +5,8 @@
 
 using namespace item;
 
-Oracle::Oracle(Moment first_moment)
-    :Item{first_moment, FirstProperties()} {}
+Oracle::Oracle(Moment first_moment, ItemStateTable* table, int column)
+    :Item{first_moment, FirstProperties(), table, column} {}
 
 ItemProperties Oracle::FirstProperties() noexcept {
     ItemProperties result{};
@@ -52,21 +52,16 @@ std::pair<Effect, ItemProperties> Oracle::BranchImpl(Moment, Moment dest) {
     return result;
 }
 
-TaggedValues Oracle::StateTaggedValues(Moment m) const {
+StateTags Oracle::State(Moment m) const {
     ItemProperties const& properties = GetProperties(m);
-    TaggedValues result;
+    StateTags result;
     int lockdown = properties.lockdown();
     if (lockdown > 0) {
-        result.emplace_back("unlock_requirement", std::to_string(lockdown));
+        result.Add(StateTag::kUnlockRequirement, lockdown);
     } else {
-        result.emplace_back("activation_energy",
-                            std::to_string(properties.cooldown() + 1));
-        int value = properties.custom(kActivatedID);
-        if (value) {
-            result.emplace_back("oracle_activated", "Inactive");
-        } else {
-            result.emplace_back("oracle_activated", "Active");
-        }
+        result.Add(StateTag::kActivationEnergy, properties.cooldown() + 1);
+        result.Add(StateTag::kOracleActivated,
+                   properties.custom(kActivatedID) != 0);
     }
     return result;
 }
@@ -12,7 +12,7 @@ namespace item {
  * The player is made directly controllable when the Oracle is activated,
  * regardless of what timeline the activation has occurred in.
  */
-class Oracle : public Item {
+class Oracle final : public Item {
   public:
     /**
      * @brief An enum representation of the type of the item.
@@ -27,11 +27,12 @@ class Oracle : public Item {
      */
     static int constexpr kUnlockRequirement = 45;
 
-    Oracle(Moment first_moment);
+    Oracle(Moment first_moment, ItemStateTable* table = nullptr,
+           int column = 0);
 
     Effect View(Moment m) const;
 
-    TaggedValues StateTaggedValues(Moment m) const;
+    StateTags State(Moment m) const;
 
   protected:
     std::pair<Effect, ItemProperties> StepImpl(Moment curr,
@@ -41,6 +42,8 @@ class Oracle : public Item {
         Moment curr, Moment dest);
 
   private:
+    friend class ItemSet;
+
     /* ID for whether the oracle was activated at a moment. */
     static int constexpr kActivatedID = 0;
 
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <stdexcept>
+#include "playerhistory.hpp"
+#include "roundinfo.hpp"
+
+using namespace roundinfo;
+
+PlayerHistory::PlayerHistory(int num_players)
+    :num_players_{num_players},
+     size_{0},
+     segments_{} {}
+
+void PlayerHistory::Record(Moment m, RoundInfo const& info) {
+    int timeline_num = m.parent_timeline_num();
+    if (timeline_num >= static_cast<int>(segments_.size())) {
+        segments_.resize(timeline_num + 1, Segment{
+            0, 0, std::vector<std::vector<int>>(kNumFields * num_players_)});
+    }
+    Segment& segment = segments_[timeline_num];
+    if (segment.length == 0) {
+        segment.begin_time = m.time();
+    } else if (m.time() != segment.begin_time + segment.length) {
+        throw std::invalid_argument("Moment is out of order for its timeline");
+    }
+    for (int player = 0; player < num_players_; player++) {
+        segment.columns[kLocation * num_players_ + player].push_back(
+            info.Location(player, RoundInfo::kOmniscientViewer));
+        segment.columns[kHealthRemaining * num_players_ + player].push_back(
+            info.HealthRemaining(player, RoundInfo::kOmniscientViewer));
+        segment.columns[kDamageReceived * num_players_ + player].push_back(
+            info.DamageReceived(player, RoundInfo::kOmniscientViewer));
+    }
+    segment.length++;
+    size_++;
+}
+
+int PlayerHistory::Reclaim(timeplane::RetirementLog const& log, int epoch) {
+    int result = 0;
+    for (int e = epoch; e < log.epoch(); e++) {
+        auto const& retirement = log.at(e);
+        if (retirement.timeline_num >= static_cast<int>(segments_.size())) {
+            continue;
+        }
+        Segment& segment = segments_[retirement.timeline_num];
+        int new_length = std::max(0, retirement.begin_time -
+                                     segment.begin_time);
+        if (new_length >= segment.length) {
+            continue;
+        }
+        for (std::vector<int>& column: segment.columns) {
+            column.resize(new_length);
+        }
+        result += segment.length - new_length;
+        size_ -= segment.length - new_length;
+        segment.length = new_length;
+    }
+    return result;
+}
+
+std::size_t PlayerHistory::memory_bytes() const noexcept {
+    std::size_t result = segments_.capacity() * sizeof(Segment);
+    for (Segment const& segment: segments_) {
+        result += segment.columns.capacity() * sizeof(std::vector<int>);
+        for (std::vector<int> const& column: segment.columns) {
+            result += column.capacity() * sizeof(int);
+        }
+    }
+    return result;
+}
+
+int const* PlayerHistory::GetColumn(Field field, int timeline_num,
+                                    int begin_time, int end_time,
+                                    int player) const {
+    if (player < 0 || player >= num_players_) {
+        throw std::out_of_range("Player ID is invalid");
+    }
+    if (timeline_num < 0 ||
+            timeline_num >= static_cast<int>(segments_.size())) {
+        throw std::out_of_range("No history recorded for the moments");
+    }
+    Segment const& segment = segments_[timeline_num];
+    if (begin_time < segment.begin_time || begin_time > end_time ||
+            end_time > segment.begin_time + segment.length) {
+        throw std::out_of_range("No history recorded for the moments");
+    }
+    return segment.columns[field * num_players_ + player].data() +
+           (begin_time - segment.begin_time);
+}
+
+int PlayerHistory::Value(Field field, Moment m, int player) const {
+    return *GetColumn(field, m.parent_timeline_num(), m.time(),
+                      m.time() + 1, player);
+}
+
+PlayerHistory::ColumnRange PlayerHistory::Column(
+        Field field, timeplane::TimeLine::Span const& span,
+        int player) const {
+    int const* first = GetColumn(field, span.timeline_num, span.begin_time,
+                                 span.end_time, player);
+    return ColumnRange{first, first + (span.end_time - span.begin_time)};
+}
@@ -0,0 +1,223 @@
+#ifndef PLAYER_HISTORY_H
+#define PLAYER_HISTORY_H
+
+#include <cstddef>
+#include <vector>
+#include "moment.hpp"
+#include "retirementlog.hpp"
+#include "timeline.hpp"
+
+namespace roundinfo {
+class RoundInfo;
+
+using Moment = timeplane::Moment;
+
+/**
+ * @brief The history of every player stored as columns per timeline.
+ *
+ * For the moments owned by each timeline, the location, health remaining
+ * and damage received of each player are kept in arrays indexed by time.
+ * Scanning the history of a player across a range of times then reads
+ * contiguous memory for every span of the range, instead of looking up
+ * the @c RoundInfo of every moment. All values are as seen by an
+ * omniscient viewer.
+ */
+class PlayerHistory {
+  public:
+    /**
+     * @brief A contiguous range of values from one column.
+     */
+    struct ColumnRange {
+        /**
+         * @brief Pointer to the first value.
+         */
+        int const* first;
+
+        /**
+         * @brief Pointer one past the last value.
+         */
+        int const* last;
+
+        /**
+         * @brief Iterator to the beginning of the range.
+         * @return Pointer to the first value.
+         */
+        int const* begin() const noexcept {
+            return first;
+        }
+
+        /**
+         * @brief Iterator to the end of the range.
+         * @return Pointer one past the last value.
+         */
+        int const* end() const noexcept {
+            return last;
+        }
+
+        /**
+         * @brief Accessor for the number of values in the range.
+         * @return The number of values in the range.
+         */
+        int size() const noexcept {
+            return static_cast<int>(last - first);
+        }
+    };
+
+    /**
+     * @brief Constructor.
+     * @param num_players       The number of players in the game.
+     */
+    explicit PlayerHistory(int num_players);
+
+    /**
+     * @brief Accessor for the number of players in the game.
+     * @return The number of players in the game.
+     */
+    int num_players() const noexcept {
+        return num_players_;
+    }
+
+    /**
+     * @brief Accessor for the number of moments recorded.
+     * @return The number of moments whose history is stored.
+     */
+    int size() const noexcept {
+        return size_;
+    }
+
+    /**
+     * @brief Records the history of every player at a moment.
+     *
+     * The moments owned by a timeline must be recorded in chronological
+     * order without gaps, starting at any time.
+     * @param m         The moment to record.
+     * @param info      The round information of the moment.
+     * @throws std::invalid_argument If the moment is not the next one to
+     *      record for its timeline.
+     */
+    void Record(Moment m, RoundInfo const& info);
+
+    /**
+     * @brief Accessor for the location of a player.
+     * @param m         The moment to query.
+     * @param player    The player ID to query.
+     * @return The location of the player at the moment.
+     * @throws std::out_of_range If the moment was not recorded or the
+     *      player ID is invalid.
+     */
+    int Location(Moment m, int player) const {
+        return Value(kLocation, m, player);
+    }
+
+    /**
+     * @brief Accessor for the health a player has remaining.
+     * @param m         The moment to query.
+     * @param player    The player ID to query.
+     * @return The health remaining of the player at the moment.
+     * @throws std::out_of_range If the moment was not recorded or the
+     *      player ID is invalid.
+     */
+    int HealthRemaining(Moment m, int player) const {
+        return Value(kHealthRemaining, m, player);
+    }
+
+    /**
+     * @brief Accessor for the damage a player received.
+     * @param m         The moment to query.
+     * @param player    The player ID to query.
+     * @return The damage received by the player at the moment.
+     * @throws std::out_of_range If the moment was not recorded or the
+     *      player ID is invalid.
+     */
+    int DamageReceived(Moment m, int player) const {
+        return Value(kDamageReceived, m, player);
+    }
+
+    /**
+     * @brief Accesses the locations of a player over a span of moments.
+     * @param span      The span of moments to query.
+     * @param player    The player ID to query.
+     * @return The locations of the player, in chronological order.
+     * @throws std::out_of_range If any moment in the span was not recorded
+     *      or the player ID is invalid.
+     */
+    ColumnRange Locations(timeplane::TimeLine::Span const& span,
+                          int player) const {
+        return Column(kLocation, span, player);
+    }
+
+    /**
+     * @brief Accesses the health remaining of a player over a span.
+     * @param span      The span of moments to query.
+     * @param player    The player ID to query.
+     * @return The health remaining of the player, in chronological order.
+     * @throws std::out_of_range If any moment in the span was not recorded
+     *      or the player ID is invalid.
+     */
+    ColumnRange HealthRemainings(timeplane::TimeLine::Span const& span,
+                                 int player) const {
+        return Column(kHealthRemaining, span, player);
+    }
+
+    /**
+     * @brief Accesses the damage received by a player over a span.
+     * @param span      The span of moments to query.
+     * @param player    The player ID to query.
+     * @return The damage received by the player, in chronological order.
+     * @throws std::out_of_range If any moment in the span was not recorded
+     *      or the player ID is invalid.
+     */
+    ColumnRange DamageReceiveds(timeplane::TimeLine::Span const& span,
+                                int player) const {
+        return Column(kDamageReceived, span, player);
+    }
+
+    /**
+     * @brief Erases the history of every moment retired since an epoch.
+     *
+     * Retired moments are always the latest moments of their timeline,
+     * so the columns are simply truncated.
+     * @param log       The log of retired moments.
+     * @param epoch     The epoch up to which history was already erased.
+     * @return The number of moments whose history was erased.
+     */
+    int Reclaim(timeplane::RetirementLog const& log, int epoch);
+
+    /**
+     * @brief Accessor for the memory held by the columns.
+     * @return The approximate number of bytes allocated.
+     */
+    std::size_t memory_bytes() const noexcept;
+
+  private:
+    enum Field {
+        kLocation,
+        kHealthRemaining,
+        kDamageReceived,
+        kNumFields
+    };
+
+    /* The columns of the moments owned by one timeline */
+    struct Segment {
+        int begin_time;
+        int length;
+        // Indexed by field and then by player
+        std::vector<std::vector<int>> columns;
+    };
+
+    int num_players_;
+    int size_;
+    // Indexed by timeline number
+    std::vector<Segment> segments_;
+
+    int const* GetColumn(Field field, int timeline_num, int begin_time,
+                         int end_time, int player) const;
+
+    int Value(Field field, Moment m, int player) const;
+
+    ColumnRange Column(Field field, timeplane::TimeLine::Span const& span,
+                       int player) const;
+};
+}
+
+#endif //PLAYER_HISTORY_H
@@ -0,0 +1,98 @@
+#ifndef PROPERTIES_POOL_H
+#define PROPERTIES_POOL_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include "itemproperties.hpp"
+
+namespace item {
+
+/**
+ * @brief A pool holding one canonical copy of every distinct set of item
+ * properties.
+ *
+ * Items only ever reach a small number of distinct properties, so storing
+ * a handle to the canonical copy instead of the properties themselves
+ * makes memory scale with the distinct properties instead of the moments.
+ * Two handles from the same pool are equal exactly when their properties
+ * are equal.
+ *
+ * Entries are never removed, and references to them remain valid for the
+ * lifetime of the pool.
+ */
+class PropertiesPool {
+  public:
+    /**
+     * @brief The type of the handle to an entry of the pool.
+     */
+    using Handle = std::uint32_t;
+
+    /**
+     * @brief Default constructor.
+     */
+    PropertiesPool()
+        :values_{},
+         handles_{} {}
+
+    PropertiesPool(PropertiesPool const&) = delete;
+    PropertiesPool& operator=(PropertiesPool const&) = delete;
+
+    /**
+     * @brief Accessor for the number of entries.
+     * @return The number of distinct properties interned.
+     */
+    int size() const noexcept {
+        return static_cast<int>(values_.size());
+    }
+
+    /**
+     * @brief Finds or adds the canonical copy of some properties.
+     *
+     * The cost is a hash lookup, plus an insertion for new properties.
+     * @param properties        The properties to intern.
+     * @return The handle to the canonical copy.
+     */
+    Handle Intern(ItemProperties const& properties) {
+        auto iter = handles_.find(properties);
+        if (iter != handles_.end()) {
+            return iter->second;
+        }
+        Handle result = static_cast<Handle>(values_.size());
+        values_.push_back(properties);
+        handles_.emplace(properties, result);
+        return result;
+    }
+
+    /**
+     * @brief Accesses the canonical copy of some properties.
+     * @param handle        A handle obtained from @c Intern.
+     * @return A reference to the properties.
+     */
+    ItemProperties const& at(Handle handle) const noexcept {
+        assert(handle < values_.size());
+        return values_[handle];
+    }
+
+    /**
+     * @brief Accessor for the memory held by the pool.
+     * @return The approximate number of bytes allocated.
+     */
+    std::size_t memory_bytes() const noexcept {
+        // Each node of the index holds a key, a handle and a pointer
+        std::size_t node_bytes = sizeof(ItemProperties) + sizeof(Handle) +
+                                 sizeof(void*);
+        return values_.size() * (sizeof(ItemProperties) + node_bytes) +
+               handles_.bucket_count() * sizeof(void*);
+    }
+
+  private:
+    // Indexed by handle, and never reallocated so references stay valid
+    std::deque<ItemProperties> values_;
+    std::unordered_map<ItemProperties, Handle> handles_;
+};
+}
+
+#endif //PROPERTIES_POOL_H
@@ -0,0 +1,146 @@
+#ifndef RETIREMENT_LOG_H
+#define RETIREMENT_LOG_H
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include "moment.hpp"
+
+namespace timeplane {
+
+/**
+ * @brief A record of the @c Moment instances that have been retired.
+ *
+ * A moment is retired once it is no longer externally accessible. Moments
+ * are always retired as a contiguous range at the end of the moments
+ * owned by one timeline, so each retirement is a single entry no matter
+ * how many moments it covers.
+ *
+ * Every retirement begins a new epoch. Stores of per-moment data keep the
+ * epoch up to which they have reclaimed their data, and later drop the
+ * data of everything retired since then in a single pass.
+ */
+class RetirementLog {
+  public:
+    /**
+     * @brief A range of retired moments belonging to one timeline.
+     */
+    struct Retirement {
+        /**
+         * @brief The timeline number of every moment in the range.
+         */
+        int timeline_num;
+
+        /**
+         * @brief The time of the first moment in the range.
+         */
+        int begin_time;
+
+        /**
+         * @brief The time one past the last moment in the range.
+         */
+        int end_time;
+
+        /**
+         * @brief Accessor for the number of moments in the range.
+         * @return The number of moments retired.
+         */
+        int size() const noexcept {
+            return end_time - begin_time;
+        }
+    };
+
+    /**
+     * @brief Default constructor.
+     *
+     * The log starts at epoch 0 with no moments retired.
+     */
+    RetirementLog()
+        :retirements_(),
+         retired_before_(1, 0),
+         live_ends_() {}
+
+    /**
+     * @brief Accessor for the current epoch.
+     * @return The number of retirements recorded so far.
+     */
+    int epoch() const noexcept {
+        return static_cast<int>(retirements_.size());
+    }
+
+    /**
+     * @brief Accesses the retirement that ended an epoch.
+     * @param epoch     The epoch to query.
+     * @return The retirement that moved the log from the epoch to the
+     *      next one.
+     * @throws std::out_of_range If the epoch has not ended yet.
+     */
+    Retirement const& at(int epoch) const {
+        if (epoch < 0 || epoch >= this->epoch()) {
+            throw std::out_of_range("Epoch has not ended yet.");
+        }
+        return retirements_[epoch];
+    }
+
+    /**
+     * @brief Counts the moments retired since an epoch.
+     * @param epoch     The epoch to count from.
+     * @return The number of moments retired from the start of the epoch
+     *      until now.
+     */
+    int RetiredSince(int epoch) const noexcept {
+        assert(epoch >= 0 && epoch <= this->epoch());
+        return retired_before_.back() - retired_before_[epoch];
+    }
+
+    /**
+     * @brief Checks whether a moment has been retired.
+     * @param m     The moment to query.
+     * @return Whether the moment has been retired.
+     */
+    bool IsRetired(Moment m) const noexcept {
+        int timeline_num = m.parent_timeline_num();
+        if (timeline_num >= static_cast<int>(live_ends_.size())) {
+            return false;
+        }
+        return m.time() >= live_ends_[timeline_num];
+    }
+
+    /**
+     * @brief Records a newly retired range of moments.
+     *
+     * The range must end where the moments of the timeline that are not
+     * yet retired end, and moments are expected to be retired at most once.
+     * @param timeline_num      The timeline number of the moments.
+     * @param begin_time        The time of the first moment retired.
+     * @param end_time          The time one past the last moment retired.
+     */
+    void Retire(int timeline_num, int begin_time, int end_time) {
+        assert(timeline_num >= 0 && begin_time <= end_time);
+        if (begin_time == end_time) {
+            return;
+        }
+        if (timeline_num >= static_cast<int>(live_ends_.size())) {
+            live_ends_.resize(timeline_num + 1, int{kNeverRetired});
+        }
+        int& live_end = live_ends_[timeline_num];
+        live_end = std::min(live_end, begin_time);
+        retirements_.push_back(Retirement{timeline_num, begin_time, end_time});
+        retired_before_.push_back(retired_before_.back() +
+                                  (end_time - begin_time));
+    }
+
+  private:
+    static int constexpr kNeverRetired = std::numeric_limits<int>::max();
+
+    std::vector<Retirement> retirements_;
+    // The number of moments retired before each epoch
+    std::vector<int> retired_before_;
+    // The time at which retired moments begin, indexed by timeline number
+    std::vector<int> live_ends_;
+};
+}
+
+#endif //RETIREMENT_LOG_H
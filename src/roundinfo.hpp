@@ -3,8 +3,12 @@
 
 #include <cstdint>
 #include <utility>
+#include <cassert>
 #include <vector>
+#include <boost/serialization/access.hpp>
+#include <boost/serialization/vector.hpp>
 #include "aliases.hpp"
+#include "boost_serialization_dynamic_bitset.hpp"
 #include "symmetricbitmatrix.hpp"
 
 namespace roundinfo {
@@ -29,6 +33,16 @@ class RoundInfo {
     static int constexpr kGraveyardLocation = -2;
     static int constexpr kOmniscientViewer = -1;
 
+    /**
+     * @brief Default constructor.
+     *
+     * The instance holds no players. The only mutator that can change this
+     * is the @c serialize function, and so this constructor should only be
+     * used to deserialize an instance.
+     */
+    RoundInfo()
+        :RoundInfo{0} {}
+
     /**
      * @brief Constructor.
      *
@@ -142,7 +156,24 @@ class RoundInfo {
                    static_cast<RoundInfo const&>(*this).alliance_data());
     }
 
+    /**
+     * @brief Serialization function.
+     *
+     * @tparam Archive      The serialization archive type.
+     * @param ar            The serialization archive.
+     * @param version       The verion of the serialization protocol to use.
+     */
+    template<typename Archive>
+    void serialize(Archive& ar, unsigned int const version) {
+        (void)version;
+        assert(version == 0);
+        ar & num_players_ & location_data_ & damage_received_data_;
+        ar & health_remaining_data_ & active_data_ & alliance_data_;
+    }
+
   private:
+    friend class boost::serialization::access;
+
     int num_players_;
     std::vector<int> location_data_;
     std::vector<int> damage_received_data_;
@@ -0,0 +1,407 @@
+#ifndef SHARED_MOMENT_MAP_H
+#define SHARED_MOMENT_MAP_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "moment.hpp"
+#include "retirementlog.hpp"
+#include "spillfile.hpp"
+#include "tieredmomentmap.hpp"
+
+namespace timeplane {
+
+/**
+ * @brief An associative container from @c Moment instances to immutable
+ * values, where copies share their storage.
+ *
+ * The values of the moments owned by each timeline are kept in
+ * chronological order, split into fixed-size chunks that are reached
+ * through a growable index. Every slot of a chunk or an index is written
+ * at most once, and a copy never reads past the values it holds, so the
+ * slots after them are filled in place even while copies share the chunk.
+ * Copying the container only copies one pointer per timeline, so a copy
+ * can be handed to other threads as a consistent view while the original
+ * keeps growing. A chunk or an index is only copied once another instance
+ * has already written past the values this one holds.
+ *
+ * The values of old moments can be moved out to a file shared by every
+ * copy made afterwards, and are read back whenever they are found.
+ *
+ * Distinct instances may be used from different threads at the same time,
+ * but a single instance is not thread-safe.
+ * @tparam T        The type of the values stored.
+ */
+template <typename T>
+class SharedMomentMap {
+  public:
+    /**
+     * @brief The number of values held by a full chunk.
+     */
+    static int constexpr kChunkSize = 32;
+
+    /**
+     * @brief Default constructor.
+     */
+    SharedMomentMap()
+        :runs_{},
+         file_{},
+         size_{0},
+         num_spilled_{0} {}
+
+    /**
+     * @brief Accessor for the number of entries.
+     * @return The number of moments with a stored value.
+     */
+    int size() const noexcept {
+        return size_;
+    }
+
+    /**
+     * @brief Accessor for the number of spilled entries.
+     * @return The number of moments whose value was moved out to a file.
+     */
+    int num_spilled() const noexcept {
+        return num_spilled_;
+    }
+
+    /**
+     * @brief Summarizes the memory used by the container.
+     *
+     * Chunks shared with copies are counted in full. The cost is linear in
+     * the number of timelines.
+     * @return The number of entries and the approximate bytes held for them.
+     */
+    StoreUsage usage() const noexcept {
+        std::size_t bytes = runs_.capacity() * sizeof(Run);
+        for (Run const& run: runs_) {
+            if (run.index) {
+                int num_chunks = (run.length + kChunkSize - 1) / kChunkSize;
+                bytes += run.index->capacity * sizeof(std::shared_ptr<Chunk>) +
+                         num_chunks * sizeof(Chunk);
+            }
+            bytes += (run.length - run.num_spilled) * sizeof(T);
+        }
+        return StoreUsage{size_, num_spilled_, bytes};
+    }
+
+    /**
+     * @brief Counts the entries associated with a moment.
+     * @param m     The moment to query.
+     * @return 1 if a value is stored for the moment, otherwise 0.
+     */
+    int count(Moment m) const noexcept {
+        return FindSlot(m) != nullptr ? 1 : 0;
+    }
+
+    /**
+     * @brief Finds the value associated with a moment.
+     *
+     * A spilled value is read back into a new instance every time.
+     * @param m     The moment to query.
+     * @return A pointer to the value, or @c nullptr if there is none.
+     * @throws std::runtime_error If a spilled value cannot be read back.
+     */
+    std::shared_ptr<T const> Find(Moment m) const {
+        Slot const* slot = FindSlot(m);
+        if (slot == nullptr) {
+            return nullptr;
+        }
+        if (slot->value) {
+            return slot->value;
+        }
+        auto result = std::make_shared<T>();
+        file_->Load(slot->record, *result);
+        return result;
+    }
+
+    /**
+     * @brief Accesses the value associated with a moment.
+     * @param m     The moment to query.
+     * @return A pointer to the value.
+     * @throws std::out_of_range If no value is stored for the moment.
+     * @throws std::runtime_error If a spilled value cannot be read back.
+     */
+    std::shared_ptr<T const> at(Moment m) const {
+        std::shared_ptr<T const> result = Find(m);
+        if (result == nullptr) {
+            throw std::out_of_range("No value stored for the moment.");
+        }
+        return result;
+    }
+
+    /**
+     * @brief Copies the values of some timelines only.
+     *
+     * Only the values of the timelines copied are shared, so the cost
+     * grows with the number of those timelines and the largest of their
+     * numbers, rather than with every timeline ever stored.
+     * @param timeline_nums     The numbers of the timelines to copy, where
+     *      repeated numbers are copied once.
+     * @return A copy holding the values of the timelines, which shares
+     *      their storage with the instance.
+     */
+    SharedMomentMap Share(std::vector<int> const& timeline_nums) const {
+        SharedMomentMap result{};
+        result.file_ = file_;
+        int num_runs = static_cast<int>(runs_.size());
+        for (int timeline_num: timeline_nums) {
+            if (timeline_num >= num_runs || !runs_[timeline_num].index) {
+                continue;
+            }
+            if (timeline_num >= static_cast<int>(result.runs_.size())) {
+                result.runs_.resize(timeline_num + 1, Run{0, 0, 0, nullptr});
+            }
+            Run& run = result.runs_[timeline_num];
+            if (!run.index) {
+                run = runs_[timeline_num];
+                result.size_ += run.length;
+                result.num_spilled_ += run.num_spilled;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Associates a value with the next moment of its timeline.
+     *
+     * The moments owned by a timeline must be appended in chronological
+     * order without gaps, starting at any time.
+     * @param m         The moment to associate with the value.
+     * @param value     The value to store.
+     * @throws std::invalid_argument If the moment is not the next one to
+     *      append for its timeline.
+     */
+    void Append(Moment m, std::shared_ptr<T const> value) {
+        int timeline_num = m.parent_timeline_num();
+        if (timeline_num >= static_cast<int>(runs_.size())) {
+            runs_.resize(timeline_num + 1, Run{0, 0, 0, nullptr});
+        }
+        Run& run = runs_[timeline_num];
+        if (run.length == 0) {
+            run.begin_time = m.time();
+        } else if (m.time() != run.begin_time + run.length) {
+            throw std::invalid_argument(
+                "Moment is out of order for its timeline");
+        }
+        int chunk_num = run.length / kChunkSize;
+        int slot = run.length % kChunkSize;
+        if (slot == 0) {
+            auto chunk = std::make_shared<Chunk>(1);
+            chunk->slots[0].value = std::move(value);
+            SetChunk(run, chunk_num, std::move(chunk));
+        } else {
+            Chunk& last = *run.index->chunks[chunk_num];
+            if (Claim(last.num_claimed, slot)) {
+                last.slots[slot].value = std::move(value);
+            } else {
+                // Another instance has filled the slot, so only a copy of
+                // the chunk can be extended
+                auto chunk = CopyChunk(last, slot);
+                Claim(chunk->num_claimed, slot);
+                chunk->slots[slot].value = std::move(value);
+                SetChunk(run, chunk_num, std::move(chunk));
+            }
+        }
+        run.length++;
+        size_++;
+    }
+
+    /**
+     * @brief Erases the values of every moment retired since an epoch.
+     *
+     * Retired moments are always the latest moments of their timeline,
+     * so the values are simply truncated. Copies made earlier keep the
+     * values they hold.
+     * @param log       The log of retired moments.
+     * @param epoch     The epoch up to which values were already erased.
+     * @return The number of values erased.
+     */
+    int Reclaim(RetirementLog const& log, int epoch) {
+        int result = 0;
+        for (int e = epoch; e < log.epoch(); e++) {
+            RetirementLog::Retirement const& retirement = log.at(e);
+            if (retirement.timeline_num >= static_cast<int>(runs_.size())) {
+                continue;
+            }
+            Run& run = runs_[retirement.timeline_num];
+            int new_length = std::max(0, retirement.begin_time -
+                                         run.begin_time);
+            if (new_length >= run.length) {
+                continue;
+            }
+            int num_chunks = (new_length + kChunkSize - 1) / kChunkSize;
+            if (num_chunks == 0) {
+                run.index = nullptr;
+            } else {
+                run.index = CopyIndex(*run.index, num_chunks, num_chunks);
+                if (new_length % kChunkSize != 0) {
+                    run.index->chunks[num_chunks - 1] = CopyChunk(
+                        *run.index->chunks[num_chunks - 1],
+                        new_length % kChunkSize);
+                }
+            }
+            result += run.length - new_length;
+            size_ -= run.length - new_length;
+            run.length = new_length;
+            int num_spilled = std::min(run.num_spilled, new_length);
+            num_spilled_ -= run.num_spilled - num_spilled;
+            run.num_spilled = num_spilled;
+        }
+        return result;
+    }
+
+    /**
+     * @brief Moves the values of old moments out to a file.
+     *
+     * Copies made earlier keep the values they hold in RAM.
+     * @param file              The file to write the values to, which is
+     *      shared with every copy made afterwards. Every call must pass the
+     *      same file.
+     * @param before_time       The values of all moments before this time
+     *      are spilled.
+     * @return The number of values newly spilled.
+     * @throws std::runtime_error If a value cannot be written.
+     */
+    int Spill(std::shared_ptr<SpillFile> file, int before_time) {
+        assert(!file_ || file_ == file);
+        file_ = std::move(file);
+        int result = 0;
+        for (Run& run: runs_) {
+            int end = std::min(run.length, before_time - run.begin_time);
+            if (end <= run.num_spilled) {
+                continue;
+            }
+            // Copies may still read the chunks, so they are replaced
+            int num_chunks = (run.length + kChunkSize - 1) / kChunkSize;
+            run.index = CopyIndex(*run.index, num_chunks,
+                                  run.index->capacity);
+            for (int c = run.num_spilled / kChunkSize; c * kChunkSize < end;
+                    c++) {
+                int first = c * kChunkSize;
+                auto chunk = CopyChunk(*run.index->chunks[c],
+                                       std::min(kChunkSize,
+                                                run.length - first));
+                for (int i = std::max(run.num_spilled, first);
+                        i < std::min(end, first + kChunkSize); i++) {
+                    Slot& slot = chunk->slots[i - first];
+                    slot.record = file_->Save(*slot.value);
+                    slot.value = nullptr;
+                }
+                run.index->chunks[c] = std::move(chunk);
+            }
+            result += end - run.num_spilled;
+            run.num_spilled = end;
+        }
+        num_spilled_ += result;
+        return result;
+    }
+
+  private:
+    /* The value of one moment, or its location in the file if spilled */
+    struct Slot {
+        std::shared_ptr<T const> value;
+        SpillFile::Record record;
+    };
+
+    /* Values of consecutive moments, where each slot is written once */
+    struct Chunk {
+        // The number of slots some instance has claimed for writing
+        std::atomic<int> num_claimed;
+        std::array<Slot, kChunkSize> slots;
+
+        explicit Chunk(int num_claimed)
+            :num_claimed{num_claimed},
+             slots{} {}
+    };
+
+    /* The chunks of one timeline, where each slot is written once */
+    struct Index {
+        // The number of slots some instance has claimed for writing
+        std::atomic<int> num_claimed;
+        int capacity;
+        std::unique_ptr<std::shared_ptr<Chunk>[]> chunks;
+
+        Index(int num_claimed, int capacity)
+            :num_claimed{num_claimed},
+             capacity{capacity},
+             chunks{new std::shared_ptr<Chunk>[capacity]} {}
+    };
+
+    /* The values of the moments owned by one timeline */
+    struct Run {
+        int begin_time;
+        int length;
+        // The values of the earliest moments spilled to the file
+        int num_spilled;
+        std::shared_ptr<Index> index;
+    };
+
+    // Indexed by timeline number
+    std::vector<Run> runs_;
+    std::shared_ptr<SpillFile> file_;
+    int size_;
+    int num_spilled_;
+
+    /* The slot of a moment, or nullptr if there is none */
+    Slot const* FindSlot(Moment m) const noexcept {
+        int timeline_num = m.parent_timeline_num();
+        if (timeline_num >= static_cast<int>(runs_.size())) {
+            return nullptr;
+        }
+        Run const& run = runs_[timeline_num];
+        int offset = m.time() - run.begin_time;
+        if (offset < 0 || offset >= run.length) {
+            return nullptr;
+        }
+        Chunk const& chunk = *run.index->chunks[offset / kChunkSize];
+        return &chunk.slots[offset % kChunkSize];
+    }
+
+    /* Reserves the next slot, unless another instance already has it */
+    static bool Claim(std::atomic<int>& num_claimed, int slot) noexcept {
+        return num_claimed.compare_exchange_strong(slot, slot + 1);
+    }
+
+    /* A chunk holding the first values of another chunk */
+    static std::shared_ptr<Chunk> CopyChunk(Chunk const& chunk, int length) {
+        auto result = std::make_shared<Chunk>(length);
+        std::copy(chunk.slots.begin(), chunk.slots.begin() + length,
+                  result->slots.begin());
+        return result;
+    }
+
+    /* An index holding the first chunks of another index */
+    static std::shared_ptr<Index> CopyIndex(Index const& index,
+                                            int num_chunks, int capacity) {
+        auto result = std::make_shared<Index>(num_chunks, capacity);
+        std::copy(index.chunks.get(), index.chunks.get() + num_chunks,
+                  result->chunks.get());
+        return result;
+    }
+
+    /* Stores a chunk of a run, replacing the chunk at its position */
+    static void SetChunk(Run& run, int chunk_num,
+                         std::shared_ptr<Chunk> chunk) {
+        bool is_new = chunk_num * kChunkSize == run.length;
+        if (is_new && run.index && chunk_num < run.index->capacity &&
+                Claim(run.index->num_claimed, chunk_num)) {
+            run.index->chunks[chunk_num] = std::move(chunk);
+            return;
+        }
+        // The slot is taken by this or another instance, or there is no
+        // room left, so the chunks are moved to a new index
+        int capacity = std::max(4, 2 * chunk_num);
+        run.index = run.index ? CopyIndex(*run.index, chunk_num, capacity)
+                              : std::make_shared<Index>(0, capacity);
+        Claim(run.index->num_claimed, chunk_num);
+        run.index->chunks[chunk_num] = std::move(chunk);
+    }
+};
+}
+
+#endif //SHARED_MOMENT_MAP_H
@@ -5,8 +5,8 @@
 
 using namespace item;
 
-Shield::Shield(Moment first_moment)
-    :Item{first_moment, FirstProperties()} {}
+Shield::Shield(Moment first_moment, ItemStateTable* table, int column)
+    :Item{first_moment, FirstProperties(), table, column} {}
 
 ItemProperties Shield::FirstProperties() noexcept {
     ItemProperties result{};
@@ -88,22 +88,21 @@ std::pair<Effect, ItemProperties> Shield::BranchImpl(
     return result;
 }
 
-TaggedValues Shield::StateTaggedValues(Moment m) const {
+StateTags Shield::State(Moment m) const {
     ItemProperties const& properties = GetProperties(m);
-    TaggedValues result;
+    StateTags result;
     int lockdown = properties.lockdown();
     if (lockdown > 0) {
-        result.emplace_back("unlock_requirement", std::to_string(lockdown));
+        result.Add(StateTag::kUnlockRequirement, lockdown);
     } else {
         int regular = RegularFromCooldown(properties.cooldown());
-        result.emplace_back("shield_regular", std::to_string(regular));
+        result.Add(StateTag::kShieldRegular, regular);
         int phantom = properties.custom(kPhantomEnergyID);
         if (phantom > 0) {
-            result.emplace_back("shield_phantom", std::to_string(phantom));
+            result.Add(StateTag::kShieldPhantom, phantom);
         }
-        result.emplace_back(
-            "shield_carryable", std::to_string(
-                CarryableFromRegularPhantom(regular, phantom)));
+        result.Add(StateTag::kShieldCarryable,
+                   CarryableFromRegularPhantom(regular, phantom));
     }
     return result;
 }
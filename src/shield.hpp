@@ -1,4 +1,4 @@
-#ifndef SHEILD_H
+#ifndef SHIELD_H
 #define SHIELD_H
 
 #include "itemtype.hpp"
@@ -12,7 +12,7 @@ namespace item {
  * Shielding energy can be built up regularly, and can be transferred
  * to the past when the player uses the Antitelephone.
  */
-class Shield : public Item {
+class Shield final : public Item {
   public:
     /**
      * @brief An enum representation of the type of the item.
@@ -27,11 +27,12 @@ class Shield : public Item {
      */
     static int constexpr kUnlockRequirement = 45;
 
-    Shield(Moment first_moment);
+    Shield(Moment first_moment, ItemStateTable* table = nullptr,
+           int column = 0);
 
     Effect View(Moment m) const;
 
-    TaggedValues StateTaggedValues(Moment m) const;
+    StateTags State(Moment m) const;
 
   protected:
     std::pair<Effect, ItemProperties> StepImpl(Moment curr,
@@ -41,6 +42,8 @@ class Shield : public Item {
         Moment curr, Moment dest);
 
   private:
+    friend class ItemSet;
+
     /* ID for the amount of stored energy transferred from other timelines
      * which can contribute to the shield strength. */
     static int constexpr kPhantomEnergyID = 0;
@@ -0,0 +1,128 @@
+#ifndef SPILL_FILE_H
+#define SPILL_FILE_H
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+
+namespace timeplane {
+
+/**
+ * @brief A local file holding serialized values that were moved out of RAM.
+ *
+ * Values are appended to the end of the file and can be read back any
+ * number of times. The file is an anonymous temporary file, so it is
+ * removed automatically once the instance is destroyed or the process
+ * exits. The space of values that are no longer needed is not reused.
+ * Values may be loaded from any thread while one thread saves new ones.
+ */
+class SpillFile {
+  public:
+    /**
+     * @brief The location of a value stored in the file.
+     */
+    struct Record {
+        /**
+         * @brief The position of the first byte of the value.
+         */
+        long offset;
+
+        /**
+         * @brief The number of bytes taken by the value.
+         */
+        int length;
+    };
+
+    /**
+     * @brief Default constructor.
+     *
+     * @throws std::runtime_error If the temporary file cannot be created.
+     */
+    SpillFile()
+        :file_{std::tmpfile(), &std::fclose},
+         end_{0},
+         mutex_{} {
+        if (!file_) {
+            throw std::runtime_error("Unable to create the spill file.");
+        }
+    }
+
+    /**
+     * @brief Accessor for the size of the file.
+     * @return The number of bytes written to the file so far.
+     */
+    long size() const noexcept {
+        return end_;
+    }
+
+    /**
+     * @brief Appends a value to the end of the file.
+     *
+     * @tparam T        A serializable type.
+     * @param value     The value to write.
+     * @return The location to read the value back from.
+     * @throws std::runtime_error If the value cannot be written.
+     */
+    template <typename T>
+    Record Save(T const& value) {
+        std::ostringstream stream{};
+        {
+            boost::archive::binary_oarchive archive{
+                stream, boost::archive::no_header};
+            archive << value;
+        }
+        std::string const bytes = stream.str();
+        std::lock_guard<std::mutex> lock{mutex_};
+        Record result{end_, static_cast<int>(bytes.size())};
+        if (std::fseek(file_.get(), end_, SEEK_SET) != 0 ||
+                std::fwrite(bytes.data(), 1, bytes.size(), file_.get()) !=
+                bytes.size()) {
+            throw std::runtime_error("Unable to write to the spill file.");
+        }
+        end_ += result.length;
+        return result;
+    }
+
+    /**
+     * @brief Reads back a value written to the file.
+     *
+     * @tparam T        A serializable type.
+     * @param record    The location returned when the value was saved.
+     * @param value     The instance to deserialize the value into.
+     * @throws std::runtime_error If the value cannot be read.
+     */
+    template <typename T>
+    void Load(Record record, T& value) const {
+        std::string bytes(record.length, '\0');
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            if (std::fseek(file_.get(), record.offset, SEEK_SET) != 0 ||
+                    std::fread(&bytes[0], 1, bytes.size(), file_.get()) !=
+                    bytes.size()) {
+                throw std::runtime_error(
+                    "Unable to read from the spill file.");
+            }
+        }
+        std::istringstream stream{bytes};
+        boost::archive::binary_iarchive archive{
+            stream, boost::archive::no_header};
+        archive >> value;
+    }
+
+    SpillFile(SpillFile const&) = delete;
+    SpillFile& operator=(SpillFile const&) = delete;
+
+  private:
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file_;
+    long end_;
+    // Guards the position of the file
+    mutable std::mutex mutex_;
+};
+}
+
+#endif //SPILL_FILE_H
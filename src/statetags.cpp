@@ -0,0 +1,92 @@
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include "statetags.hpp"
+
+using namespace item;
+
+namespace {
+// Indexed by the ID of the tag
+char const* const kStateTagNames[StateTagCount] = {
+    "energy_debt",
+    "unlock_requirement",
+    "activation_energy",
+    "bridge_activated",
+    "bridge_charge_remaining",
+    "bridge_startup_time",
+    "oracle_activated",
+    "shield_regular",
+    "shield_phantom",
+    "shield_carryable"
+};
+
+bool IsActivationTag(StateTag tag) noexcept {
+    return tag == StateTag::kBridgeActivated ||
+           tag == StateTag::kOracleActivated;
+}
+
+/* Whether the tag is shown as "Active" for a value, which is inverted for
+ * the Oracle to keep its user-friendly form unchanged */
+bool ShownActive(StateTag tag, int value) noexcept {
+    return (value != 0) != (tag == StateTag::kOracleActivated);
+}
+}
+
+char const* item::StateTagName(StateTag tag) noexcept {
+    int id = static_cast<int>(tag);
+    assert(id >= 0 && id < StateTagCount);
+    return kStateTagNames[id];
+}
+
+TaggedValue item::FormatStateTag(StateTagValue const& value) {
+    if (IsActivationTag(value.tag)) {
+        return TaggedValue{StateTagName(value.tag),
+                           ShownActive(value.tag, value.value) ?
+                           "Active" : "Inactive"};
+    }
+    return TaggedValue{StateTagName(value.tag), std::to_string(value.value)};
+}
+
+TaggedValues item::FormatStateTags(StateTags const& tags) {
+    TaggedValues result;
+    result.reserve(tags.size());
+    for (StateTagValue const& value: tags) {
+        result.push_back(FormatStateTag(value));
+    }
+    return result;
+}
+
+StateTags item::ParseStateTags(TaggedValues const& tagged_values) {
+    if (tagged_values.size() > StateTags::kCapacity) {
+        throw std::invalid_argument("Too many state tags");
+    }
+    StateTags result{};
+    for (TaggedValue const& tagged_value: tagged_values) {
+        int id = 0;
+        while (id < StateTagCount &&
+               std::strcmp(kStateTagNames[id],
+                           tagged_value.first.c_str()) != 0) {
+            id++;
+        }
+        if (id == StateTagCount) {
+            throw std::invalid_argument("Unknown state tag");
+        }
+        StateTag tag = static_cast<StateTag>(id);
+        if (IsActivationTag(tag)) {
+            if (tagged_value.second != "Active" &&
+                    tagged_value.second != "Inactive") {
+                throw std::invalid_argument("Unknown activation state");
+            }
+            bool shown_active = tagged_value.second == "Active";
+            result.Add(tag, ShownActive(tag, shown_active));
+        } else {
+            std::size_t length = 0;
+            int value = std::stoi(tagged_value.second, &length);
+            if (length != tagged_value.second.size()) {
+                throw std::invalid_argument("State tag value is not a number");
+            }
+            result.Add(tag, value);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,195 @@
+#ifndef STATE_TAGS_H
+#define STATE_TAGS_H
+
+#include <array>
+#include <cassert>
+#include <boost/serialization/access.hpp>
+#include "aliases.hpp"
+
+namespace item {
+
+/**
+ * @brief A enumeration of every tag describing the state of an item.
+ *
+ * The user-friendly form of @c kOracleActivated has always shown the
+ * opposite of whether the Oracle is activated, so "Active" stands for a
+ * value of 0. The value itself follows the same convention as every other
+ * tag.
+ */
+enum class StateTag {
+    kEnergyDebt,
+    kUnlockRequirement,
+    kActivationEnergy,
+    kBridgeActivated,
+    kBridgeChargeRemaining,
+    kBridgeStartupTime,
+    kOracleActivated,
+    kShieldRegular,
+    kShieldPhantom,
+    kShieldCarryable
+};
+
+/**
+ * @brief The number of distinct state tags.
+ */
+int constexpr StateTagCount = 10;
+
+/**
+ * @brief A state tag together with its value.
+ *
+ * Tags that describe whether something is active hold 1 for active and 0
+ * for inactive. Every other tag holds a plain integer.
+ */
+struct StateTagValue {
+    /**
+     * @brief The tag.
+     */
+    StateTag tag;
+
+    /**
+     * @brief The value of the tag.
+     */
+    int value;
+
+    /**
+     * @brief Equality operator.
+     * @param rhs       The instance to compare against.
+     * @return Whether the tags and values are equal.
+     */
+    bool operator==(StateTagValue const& rhs) const noexcept {
+        return tag == rhs.tag && value == rhs.value;
+    }
+};
+
+/**
+ * @brief The tags describing the state of an item at a moment.
+ *
+ * The tags are stored inline in a fixed-capacity array, so building and
+ * copying them never allocates. They are only turned into user-friendly
+ * strings by @c FormatStateTags.
+ */
+class StateTags {
+  public:
+    /**
+     * @brief The largest number of tags any item reports.
+     */
+    static int constexpr kCapacity = 3;
+
+    using Iterator = StateTagValue const*;
+
+    /**
+     * @brief Default constructor.
+     */
+    StateTags() noexcept
+        :values_{},
+         size_{0} {}
+
+    /**
+     * @brief Accessor for the number of tags.
+     * @return The number of tags added.
+     */
+    int size() const noexcept {
+        return size_;
+    }
+
+    /**
+     * @brief Iterator to the first tag.
+     * @return A pointer to the first tag, in order of addition.
+     */
+    Iterator begin() const noexcept {
+        return values_.data();
+    }
+
+    /**
+     * @brief Iterator past the last tag.
+     * @return A pointer past the last tag.
+     */
+    Iterator end() const noexcept {
+        return values_.data() + size_;
+    }
+
+    /**
+     * @brief Adds a tag.
+     * @param tag       The tag to add.
+     * @param value     The value of the tag.
+     */
+    void Add(StateTag tag, int value) noexcept {
+        assert(size_ < kCapacity);
+        values_[size_++] = StateTagValue{tag, value};
+    }
+
+    /**
+     * @brief Equality operator.
+     * @param rhs       The instance to compare against.
+     * @return Whether the same tags were added with the same values.
+     */
+    bool operator==(StateTags const& rhs) const noexcept {
+        if (size_ != rhs.size_) {
+            return false;
+        }
+        for (int i = 0; i < size_; i++) {
+            if (!(values_[i] == rhs.values_[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Serialization function.
+     *
+     * @tparam Archive      The serialization archive type.
+     * @param ar            The serialization archive.
+     * @param version       The verion of the serialization protocol to use.
+     */
+    template <typename Archive>
+    void serialize(Archive& ar, unsigned int const version) {
+        (void)version;
+        assert(version == 0);
+        ar & size_;
+        assert(size_ >= 0 && size_ <= kCapacity);
+        for (int i = 0; i < size_; i++) {
+            ar & values_[i].tag & values_[i].value;
+        }
+    }
+
+  private:
+    friend class boost::serialization::access;
+
+    std::array<StateTagValue, kCapacity> values_;
+    int size_;
+};
+
+/**
+ * @brief Obtains the user-friendly name of a state tag.
+ * @param tag       The tag to query.
+ * @return The name of the tag.
+ */
+char const* StateTagName(StateTag tag) noexcept;
+
+/**
+ * @brief Produces the user-friendly form of a state tag.
+ * @param value     The tag and its value.
+ * @return The name of the tag and its value as a string.
+ */
+TaggedValue FormatStateTag(StateTagValue const& value);
+
+/**
+ * @brief Produces the user-friendly form of the state of an item.
+ * @param tags      The tags describing the state.
+ * @return The name and value of every tag, in order of addition.
+ */
+TaggedValues FormatStateTags(StateTags const& tags);
+
+/**
+ * @brief Reads the state of an item back from its user-friendly form.
+ * @param tagged_values     The tagged values made by @c FormatStateTags.
+ * @return The tags describing the state.
+ * @throws std::invalid_argument If a name or value is not recognized, or
+ *      there are too many tags.
+ * @throws std::out_of_range If a value does not fit in an @c int.
+ */
+StateTags ParseStateTags(TaggedValues const& tagged_values);
+}
+
+#endif //STATE_TAGS_H
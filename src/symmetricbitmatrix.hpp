@@ -1,8 +1,11 @@
 #ifndef SYMMETRIC_BIT_MATRIX_H
 #define SYMMETRIC_BIT_MATRIX_H
 
+#include <cassert>
 #include <cstdint>
 #include <boost/dynamic_bitset.hpp>
+#include <boost/serialization/access.hpp>
+#include "boost_serialization_dynamic_bitset.hpp"
 
 /**
  * @brief A symmetric square matrix of boolean values.
@@ -47,12 +50,28 @@ class SymmetricBitMatrix {
         bits_[GetPos(row, col)] = value;
     }
 
+    /**
+     * @brief Serialization function.
+     *
+     * @tparam Archive      The serialization archive type.
+     * @param ar            The serialization archive.
+     * @param version       The verion of the serialization protocol to use.
+     */
+    template<typename Archive>
+    void serialize(Archive& ar, unsigned int const version) {
+        (void)version;
+        assert(version == 0);
+        ar & size_ & bits_;
+    }
+
     SymmetricBitMatrix(SymmetricBitMatrix const& rhs) = default;
     SymmetricBitMatrix(SymmetricBitMatrix&& rhs) = default;
     SymmetricBitMatrix& operator=(SymmetricBitMatrix const& rhs) = delete;
     SymmetricBitMatrix& operator=(SymmetricBitMatrix&& rhs) = delete;
 
   private:
+    friend class boost::serialization::access;
+
     int size_;
     boost::dynamic_bitset<uintptr_t> bits_; // Machine word size blocks
 
@@ -0,0 +1,273 @@
+#ifndef TIERED_MOMENT_MAP_H
+#define TIERED_MOMENT_MAP_H
+
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "moment.hpp"
+#include "momentmap.hpp"
+#include "retirementlog.hpp"
+#include "spillfile.hpp"
+
+namespace timeplane {
+
+/**
+ * @brief A summary of the memory used by a store of per-moment data.
+ */
+struct StoreUsage {
+    /**
+     * @brief The number of moments with stored data.
+     */
+    int num_entries;
+
+    /**
+     * @brief The number of entries only stored in a spill file.
+     */
+    int num_spilled;
+
+    /**
+     * @brief The approximate number of bytes held in RAM, not counting
+     * any memory owned by the values themselves.
+     */
+    std::size_t bytes;
+};
+
+/**
+ * @brief An associative container from @c Moment instances to values,
+ * where the values of old moments can be moved out to a file.
+ *
+ * Values start out in RAM. Calling @c Spill serializes the values of
+ * every moment before a given time into a @c SpillFile and keeps only
+ * their location in RAM. Spilled values remain accessible, since lookups
+ * transparently read them back and cache them until the next spill.
+ *
+ * Spilled values are read-only, so only constant access is provided.
+ * Pointers to values are invalidated by any insertion, erasure or spill.
+ * @tparam T        The type of the values stored, which must be default
+ *      constructible and serializable.
+ */
+template <typename T>
+class TieredMomentMap {
+  public:
+    /**
+     * @brief Default constructor.
+     */
+    TieredMomentMap()
+        :hot_{},
+         cold_{},
+         reloaded_{},
+         file_{nullptr} {}
+
+    TieredMomentMap(TieredMomentMap&&) = default;
+    TieredMomentMap& operator=(TieredMomentMap&&) = default;
+    TieredMomentMap(TieredMomentMap const&) = delete;
+    TieredMomentMap& operator=(TieredMomentMap const&) = delete;
+
+    /**
+     * @brief Accessor for the number of entries.
+     * @return The number of moments with a stored value, including the
+     *      values that were spilled.
+     */
+    int size() const noexcept {
+        return hot_.size() + cold_.size();
+    }
+
+    /**
+     * @brief Accessor for the number of spilled entries.
+     * @return The number of values that are only stored in the file.
+     */
+    int num_spilled() const noexcept {
+        return cold_.size();
+    }
+
+    /**
+     * @brief Summarizes the memory used by the instance.
+     *
+     * The cost does not depend on the number of entries.
+     * @return The number of entries and the approximate bytes held.
+     */
+    StoreUsage usage() const noexcept {
+        // Each node read back holds a key, a value and about two pointers
+        std::size_t node_bytes =
+            sizeof(MomentKey) + sizeof(T) + 2 * sizeof(void*);
+        std::size_t bytes = hot_.memory_bytes() + cold_.memory_bytes() +
+                            reloaded_.size() * node_bytes +
+                            reloaded_.bucket_count() * sizeof(void*);
+        return StoreUsage{size(), num_spilled(), bytes};
+    }
+
+    /**
+     * @brief Finds the value associated with a moment.
+     * @param m     The moment to query.
+     * @return A pointer to the value, or @c nullptr if there is none.
+     * @throws std::runtime_error If a spilled value cannot be read back.
+     */
+    T const* Find(Moment m) const {
+        T const* result = hot_.Find(m);
+        if (result != nullptr) {
+            return result;
+        }
+        SpillFile::Record const* record = cold_.Find(m);
+        if (record == nullptr) {
+            return nullptr;
+        }
+        auto iter = reloaded_.find(m.key());
+        if (iter == reloaded_.end()) {
+            T value{};
+            file_->Load(*record, value);
+            iter = reloaded_.emplace(m.key(), std::move(value)).first;
+        }
+        return &iter->second;
+    }
+
+    /**
+     * @brief Finds the value associated with a moment for modification,
+     * as long as the value was not spilled.
+     * @param m     The moment to query.
+     * @return A pointer to the value, or @c nullptr if there is none in RAM.
+     */
+    T* FindUnspilled(Moment m) noexcept {
+        return hot_.Find(m);
+    }
+
+    /**
+     * @brief Calls a function on every value that was not spilled.
+     * @tparam Fn       A function taking a @c Moment and a value reference.
+     * @param fn        The function to call.
+     */
+    template <typename Fn>
+    void ForEachUnspilled(Fn&& fn) const {
+        hot_.ForEach(std::forward<Fn>(fn));
+    }
+
+    /**
+     * @brief Accesses the value associated with a moment.
+     * @param m     The moment to query.
+     * @return A reference to the value.
+     * @throws std::out_of_range If no value is stored for the moment.
+     * @throws std::runtime_error If a spilled value cannot be read back.
+     */
+    T const& at(Moment m) const {
+        T const* result = Find(m);
+        if (result == nullptr) {
+            throw std::out_of_range("No value stored for the moment.");
+        }
+        return *result;
+    }
+
+    /**
+     * @brief Counts the values associated with a moment.
+     * @param m     The moment to query.
+     * @return 1 if a value is stored for the moment, otherwise 0.
+     */
+    int count(Moment m) const noexcept {
+        return hot_.count(m) + cold_.count(m);
+    }
+
+    /**
+     * @brief Constructs a value for a moment if there is none yet.
+     * @param m         The moment to associate with the value.
+     * @param args      The arguments to construct the value from.
+     * @return Whether a new value was inserted.
+     */
+    template <typename... Args>
+    bool emplace(Moment m, Args&&... args) {
+        if (cold_.count(m) != 0) {
+            return false;
+        }
+        return hot_.emplace(m, std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Erases the value associated with a moment.
+     * @param m     The moment whose value is erased.
+     * @return The number of values erased, which is either 0 or 1.
+     */
+    int erase(Moment m) {
+        reloaded_.erase(m.key());
+        return hot_.erase(m) + cold_.erase(m);
+    }
+
+    /**
+     * @brief Erases the values of every moment retired since an epoch.
+     *
+     * Spilled values are forgotten, but their space in the file is not
+     * reused.
+     * @param log       The log of retired moments.
+     * @param epoch     The epoch up to which values were already reclaimed.
+     * @return The number of values erased.
+     */
+    int Reclaim(RetirementLog const& log, int epoch) {
+        for (auto iter = reloaded_.begin(); iter != reloaded_.end();) {
+            if (log.IsRetired(Moment::FromKey(iter->first))) {
+                iter = reloaded_.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+        return hot_.Reclaim(log, epoch) + cold_.Reclaim(log, epoch);
+    }
+
+    /**
+     * @brief Moves the values of old moments out to a file.
+     *
+     * Values that were read back since the previous spill are dropped
+     * from RAM as well. Every spill of an instance must use the same file.
+     * @param file              The file to write the values to, which must
+     *      outlive the instance.
+     * @param before_time       The values of all moments before this time
+     *      are spilled.
+     * @return The number of values newly spilled.
+     * @throws std::runtime_error If a value cannot be written.
+     */
+    int Spill(SpillFile& file, int before_time) {
+        return SpillIf(file, [before_time] (Moment m) {
+            return m.time() < before_time;
+        });
+    }
+
+    /**
+     * @brief Moves the values of selected moments out to a file.
+     *
+     * Values that were read back since the previous spill are dropped
+     * from RAM as well. Every spill of an instance must use the same file.
+     * @tparam Pred     A function taking a @c Moment and returning whether
+     *      its value is spilled.
+     * @param file      The file to write the values to, which must outlive
+     *      the instance.
+     * @param pred      The function selecting the moments to spill.
+     * @return The number of values newly spilled.
+     * @throws std::runtime_error If a value cannot be written.
+     */
+    template <typename Pred>
+    int SpillIf(SpillFile& file, Pred&& pred) {
+        assert(file_ == nullptr || file_ == &file);
+        file_ = &file;
+        reloaded_.clear();
+        std::vector<Moment> spilled;
+        hot_.ForEach([&] (Moment m, T const& value) {
+            if (pred(m)) {
+                cold_.emplace(m, file.Save(value));
+                spilled.push_back(m);
+            }
+        });
+        for (Moment m: spilled) {
+            hot_.erase(m);
+        }
+        return static_cast<int>(spilled.size());
+    }
+
+  private:
+    MomentMap<T> hot_;
+    MomentMap<SpillFile::Record> cold_;
+    // Spilled values read back since the last spill, which are kept in a
+    // node-based map so that references remain valid
+    mutable std::unordered_map<MomentKey, T> reloaded_;
+    SpillFile* file_;
+};
+}
+
+#endif //TIERED_MOMENT_MAP_H
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <new>
 #include "moment.hpp"
 #include "timeline.hpp"
 
@@ -6,20 +8,64 @@ using namespace timeplane;
 ///@cond INTERNAL
 class TimeLine::Impl {
   public:
-    Impl(MomentDeleterFn moment_deleter)
-        :timeline_num_{0},
+    Impl(MomentDeleterFn moment_deleter, BlockArena* arena)
+        :arena_{arena},
+         ref_count_{0},
+         timeline_num_{0},
          left_timeline_{},
          branch_time_{0},
-         moments_{Moment{0, 0}},
+         moments_{},
          moment_deleter_{moment_deleter},
-         erase_from_{-1} {}
+         erase_from_{-1} {
+        moments_.push_back(Moment{0, 0});
+    }
 
     Impl(TimeLine const& left_timeline, int branch_time,
          MomentDeleterFn moment_deleter);
 
+    /* Allocates an instance from the arena, or the heap if there is none */
+    template <typename... Args>
+    static Impl* Make(BlockArena* arena, Args&&... args) {
+        void* memory = (arena != nullptr) ?
+                       arena->Allocate() : ::operator new(sizeof(Impl));
+        try {
+            return new (memory) Impl(std::forward<Args>(args)...);
+        } catch (...) {
+            Free(arena, memory);
+            throw;
+        }
+    }
+
+    /* Cleans up all moments before destroying the instance */
+    static void Destroy(Impl* pimpl) {
+        BlockArena* arena = pimpl->arena_;
+        pimpl->CleanUpAllMoments();
+        pimpl->~Impl();
+        Free(arena, pimpl);
+    }
+
+    BlockArena* arena() const noexcept {
+        return arena_;
+    }
+
+    void AddRef() noexcept {
+        ref_count_++;
+    }
+
+    /* Returns whether the last reference was released */
+    bool Release() noexcept {
+        return --ref_count_ == 0;
+    }
+
+    int timeline_num() const noexcept {
+        return timeline_num_;
+    }
+
     Moment const GetMoment(int time) const {
-        if (time < branch_time_ && left_timeline_) {
-            return left_timeline_->GetMoment(time);
+        if (time < branch_time_ && time >= 0) {
+            // The owner is found directly, instead of walking the branches
+            Impl const* owner = Owner(time);
+            return owner->moments_[time - owner->branch_time_];
         }
         return moments_.at(time - branch_time_);
     }
@@ -36,9 +82,65 @@ class TimeLine::Impl {
         return moments_.back();
     }
 
+    std::vector<TimeLine::Segment> Segments(int stop_before) const {
+        std::vector<TimeLine::Segment> result;
+        for (Impl const* segment = this;
+                segment != nullptr && segment->timeline_num_ > stop_before;
+                segment = segment->left_timeline_.get()) {
+            result.push_back(TimeLine::Segment{
+                segment->timeline_num_, segment->branch_time_,
+                static_cast<int>(segment->moments_.size())});
+        }
+        return result;
+    }
+
+    /* Lists the moments in a time range, one span per owner. The moments
+     * owned by an instance are numbered by time, so no lookup is needed. */
+    std::vector<TimeLine::Span> GetMoments(int begin_time,
+                                           int end_time) const {
+        if (begin_time < 0 || begin_time > end_time ||
+                end_time > branch_time_ + static_cast<int>(moments_.size())) {
+            throw std::out_of_range("Time range is not valid.");
+        }
+        std::vector<TimeLine::Span> result;
+        if (begin_time == end_time) {
+            return result;
+        }
+        if (begin_time < branch_time_) {
+            // Start from the last owner to branch at or before the time
+            auto iter = std::upper_bound(
+                            owner_runs_.cbegin(), owner_runs_.cend(),
+                            begin_time,
+            [] (int t, Impl const* owner) {
+                return t < owner->branch_time_;
+            }) - 1;
+            for (; iter != owner_runs_.cend() &&
+                    (*iter)->branch_time_ < end_time; ++iter) {
+                int run_end = (iter + 1 == owner_runs_.cend()) ?
+                              branch_time_ : (*(iter + 1))->branch_time_;
+                result.push_back(TimeLine::Span{
+                    (*iter)->timeline_num_,
+                    std::max(begin_time, (*iter)->branch_time_),
+                    std::min(end_time, run_end)});
+            }
+        }
+        if (end_time > branch_time_) {
+            result.push_back(TimeLine::Span{
+                timeline_num_, std::max(begin_time, branch_time_),
+                end_time});
+        }
+        return result;
+    }
+
+    /* Drops the per-time owners, leaving one entry per owner */
+    void CompactOwners() {
+        ::std::vector<Impl const*>().swap(owners_);
+    }
+
     /* Cleans up all moments owned by the instance */
     void CleanUpAllMoments() {
         externally_reachable_ = false;
+        ReleaseOwners();
         CleanUpMomentsInternal(branch_time_);
     }
 
@@ -47,6 +149,7 @@ class TimeLine::Impl {
      * via timelines on the right. */
     void CleanUpInternallyUnreachableMoments() {
         externally_reachable_ = false;
+        ReleaseOwners();
         int time = erase_from_;
         if (erase_from_ == kInitialEraseFrom) {
             time = branch_time_;
@@ -60,10 +163,18 @@ class TimeLine::Impl {
   private:
     static int constexpr kInitialEraseFrom = -1;
 
+    BlockArena* const arena_;
+    int ref_count_;
     int const timeline_num_;
-    ::std::shared_ptr<TimeLine::Impl> const left_timeline_;
+    ::boost::intrusive_ptr<TimeLine::Impl> const left_timeline_;
     int const branch_time_;
-    ::std::vector<Moment> moments_;
+    // Moments are never relocated once they are made
+    MomentStore moments_;
+    // The instance owning each moment before the branch time. Owners are
+    // kept alive by the chain of left timelines.
+    ::std::vector<Impl const*> owners_;
+    // The distinct owners before the branch time in chronological order
+    ::std::vector<Impl const*> owner_runs_;
     MomentDeleterFn moment_deleter_;
     int erase_from_;
     bool externally_reachable_ = true;
@@ -73,17 +184,47 @@ class TimeLine::Impl {
      * left timeline is also told to erase its moments once possible */
     void CleanUpMomentsInternal(int time);
 
+    static void Free(BlockArena* arena, void* memory) noexcept {
+        if (arena != nullptr) {
+            arena->Deallocate(memory);
+        } else {
+            ::operator delete(memory);
+        }
+    }
+
     int size() {
-        return branch_time_ + static_cast<int>(moments_.size());
+        return branch_time_ + moments_.size();
+    }
+
+    /* Finds the instance owning a moment before the branch time */
+    Impl const* Owner(int time) const {
+        if (!owners_.empty()) {
+            return owners_[time];
+        }
+        // The owner is the last one to branch at or before the time
+        auto iter = std::upper_bound(
+                        owner_runs_.cbegin(), owner_runs_.cend(), time,
+        [] (int t, Impl const* owner) {
+            return t < owner->branch_time_;
+        });
+        return *(iter - 1);
+    }
+
+    /* The owners are only needed for lookups from outside clients */
+    void ReleaseOwners() {
+        ::std::vector<Impl const*>().swap(owners_);
+        ::std::vector<Impl const*>().swap(owner_runs_);
     }
 };
 
 TimeLine::Impl::Impl(TimeLine const& left_timeline, int branch_time,
                      MomentDeleterFn moment_deleter)
-    :timeline_num_{left_timeline.pimpl_->timeline_num_ + 1},
+    :arena_{left_timeline.pimpl_->arena_},
+     ref_count_{0},
+     timeline_num_{left_timeline.pimpl_->timeline_num_ + 1},
      left_timeline_{left_timeline.pimpl_},
      branch_time_{branch_time},
-     moments_{Moment{timeline_num_, branch_time}},
+     moments_{},
      moment_deleter_{moment_deleter},
      erase_from_{-1} {
     if (branch_time < 0 ||
@@ -94,6 +235,26 @@ TimeLine::Impl::Impl(TimeLine const& left_timeline, int branch_time,
         throw std::invalid_argument("Left timeline already has a branch.");
     }
     left_timeline.pimpl_->erase_from_ = branch_time;
+    moments_.push_back(Moment{timeline_num_, branch_time});
+
+    // Flatten the owners of the left timeline up to the branch time
+    Impl const* left = left_timeline.pimpl_.get();
+    int inherited = std::min(branch_time, left->branch_time_);
+    owners_.reserve(branch_time);
+    for (int time = 0; time < inherited; time++) {
+        owners_.push_back(left->Owner(time));
+    }
+    owners_.resize(branch_time, left);
+
+    // The owners seen by the left timeline, up to the branch time
+    for (Impl const* owner: left->owner_runs_) {
+        if (owner->branch_time_ < branch_time) {
+            owner_runs_.push_back(owner);
+        }
+    }
+    if (left->branch_time_ < branch_time) {
+        owner_runs_.push_back(left);
+    }
 }
 
 void TimeLine::Impl::CleanUpMomentsInternal(int time) {
@@ -116,25 +277,29 @@ void TimeLine::Impl::CleanUpMomentsInternal(int time) {
         if (moment_deleter_) {
             moment_deleter_(std::make_pair(pos_iter, end));
         }
-        moments_.erase(pos_iter, end);
-        if (moments_.capacity() / 2 >= moments_.size()) {
-            moments_.shrink_to_fit();
-        }
+        moments_.EraseFrom(pos);
     }
 }
 
-void TimeLine::ImplDeleter(TimeLine::Impl* pimpl) {
-    pimpl->CleanUpAllMoments();
-    delete pimpl;
+namespace timeplane {
+void intrusive_ptr_add_ref(TimeLine::Impl* pimpl) noexcept {
+    pimpl->AddRef();
 }
 
-TimeLine::TimeLine(MomentDeleterFn moment_deleter)
-    :pimpl_{new TimeLine::Impl{moment_deleter}, &TimeLine::ImplDeleter} {}
+void intrusive_ptr_release(TimeLine::Impl* pimpl) {
+    if (pimpl->Release()) {
+        TimeLine::Impl::Destroy(pimpl);
+    }
+}
+}
+
+TimeLine::TimeLine(MomentDeleterFn moment_deleter, BlockArena* arena)
+    :pimpl_{Impl::Make(arena, moment_deleter, arena)} {}
 
 TimeLine::TimeLine(const TimeLine &left_timeline, int branch_time,
                    MomentDeleterFn moment_deleter)
-    :pimpl_{new TimeLine::Impl{left_timeline, branch_time,
-                               moment_deleter}, &TimeLine::ImplDeleter} {}
+    :pimpl_{Impl::Make(left_timeline.pimpl_->arena(), left_timeline,
+                       branch_time, moment_deleter)} {}
 
 TimeLine::~TimeLine() {
     CleanUp();
@@ -148,6 +313,10 @@ void TimeLine::CleanUp() {
     }
 }
 
+int TimeLine::timeline_number() const noexcept {
+    return pimpl_->timeline_num();
+}
+
 Moment const TimeLine::GetMoment(int time) const {
     return pimpl_->GetMoment(time);
 }
@@ -159,5 +328,22 @@ Moment const TimeLine::MakeMoment() {
 Moment const TimeLine::LatestMoment() const noexcept {
     return pimpl_->LatestMoment();
 }
+
+void TimeLine::CompactIndex() {
+    pimpl_->CompactOwners();
+}
+
+std::vector<TimeLine::Span> TimeLine::GetMoments(int begin_time,
+        int end_time) const {
+    return pimpl_->GetMoments(begin_time, end_time);
+}
+
+std::vector<TimeLine::Segment> TimeLine::Segments(int stop_before) const {
+    return pimpl_->Segments(stop_before);
+}
+
+std::size_t TimeLine::arena_block_size() noexcept {
+    return sizeof(Impl);
+}
 ///@endcond
 
@@ -6,10 +6,12 @@
 #include <memory>
 #include <utility>
 #include <vector>
+#include <boost/intrusive_ptr.hpp>
 #include "aliases.hpp"
+#include "blockarena.hpp"
+#include "moment.hpp"
 
 namespace timeplane {
-class Moment;
 
 /**
  * @brief A chronological sequence of @c Moment instances.
@@ -20,6 +22,72 @@ class Moment;
  */
 class TimeLine {
   public:
+    /**
+     * @brief The moments owned by one timeline in a chain of branches.
+     *
+     * A timeline owns the moments from its branch time onward, and reaches
+     * earlier moments through the segments of the timelines to its left.
+     */
+    struct Segment {
+        /**
+         * @brief The timeline number of the owner of the moments.
+         */
+        int timeline_num;
+
+        /**
+         * @brief The time of the first moment owned.
+         */
+        int branch_time;
+
+        /**
+         * @brief The number of moments owned that have not been erased,
+         * including those only reachable from the owner itself.
+         */
+        int num_moments;
+    };
+
+    /**
+     * @brief A range of consecutive moments owned by the same timeline.
+     *
+     * The moments owned by a timeline are numbered by their time, so the
+     * moments in the range are known without looking them up.
+     */
+    struct Span {
+        /**
+         * @brief The timeline number of every moment in the range.
+         */
+        int timeline_num;
+
+        /**
+         * @brief The time of the first moment in the range.
+         */
+        int begin_time;
+
+        /**
+         * @brief The time one past the last moment in the range.
+         */
+        int end_time;
+
+        /**
+         * @brief Accessor for the number of moments in the range.
+         * @return The number of moments in the range.
+         */
+        int size() const noexcept {
+            return end_time - begin_time;
+        }
+
+        /**
+         * @brief Accesses a moment in the range.
+         * @param time      The time of the moment, which must be within
+         *      the range.
+         * @return The @c Moment instance at the specified time.
+         */
+        Moment const operator[](int time) const noexcept {
+            assert(time >= begin_time && time < end_time);
+            return Moment{timeline_num, time};
+        }
+    };
+
     /**
      * @brief Default constructor.
      *
@@ -27,8 +95,13 @@ class TimeLine {
      * and in the process it creates the earliest moment as well.
      * @param moment_deleter        A handler for moments that
      *      fall out of scope from outside clients.
+     * @param arena         The arena to allocate the fixed-size state of
+     *      this timeline and every branch from, which must outlive all of
+     *      them. If null, that state is allocated on the heap. The moments
+     *      and the index of shared moments are always on the heap.
      */
-    TimeLine(MomentDeleterFn moment_deleter = MomentDeleterFn{});
+    TimeLine(MomentDeleterFn moment_deleter = MomentDeleterFn{},
+             BlockArena* arena = nullptr);
 
     /**
      * @brief Constructor from an existing timeline.
@@ -36,6 +109,8 @@ class TimeLine {
      * This constructor creates a timeline as a branch of an existing
      * timeline. It also creates a distinct @c Moment instance in
      * the newly created timeline whose time is equal to the branch time.
+     * The fixed-size state is allocated from the same arena as the
+     * existing timeline.
      * @param left_timeline     The timeline to branch from.
      * @param branch_time       The time to branch off from.
      * @param moment_deleter        A handler for moments that
@@ -58,17 +133,32 @@ class TimeLine {
      *
      * @return An ID number unique to a timeline.
      */
-    int const timeline_number() const noexcept;
+    int timeline_number() const noexcept;
 
     /**
      * @brief Accesses the moment with the specified time.
      *
+     * The cost of the lookup does not depend on the number of branches
+     * between the timeline and the owner of the moment.
      * @param time      The time to query.
      * @return The @c Moment instance at the specified time.
      * @throws std::out_of_range If no moment exists at the specified time.
      */
     Moment const GetMoment(int time) const;
 
+    /**
+     * @brief Accesses the moments within a range of times.
+     *
+     * The moments are grouped into one span for each timeline owning some
+     * of them, so the cost depends on the number of spans rather than the
+     * number of moments.
+     * @param begin_time        The time of the first moment.
+     * @param end_time          The time one past the last moment.
+     * @return The spans covering the range, in chronological order.
+     * @throws std::out_of_range If any time in the range has no moment.
+     */
+    std::vector<Span> GetMoments(int begin_time, int end_time) const;
+
     /**
      * @brief Creates a new moment at the end of the timeline.
      *
@@ -83,6 +173,35 @@ class TimeLine {
      */
     Moment const LatestMoment() const noexcept;
 
+    /**
+     * @brief Compresses the index used to access moments.
+     *
+     * This is meant for timelines that are kept around for their history.
+     * The index then takes memory proportional to the number of branches
+     * instead of the length of the timeline, at the cost of making
+     * @c GetMoment logarithmic in the number of branches.
+     */
+    void CompactIndex();
+
+    /**
+     * @brief Lists the segments holding the moments of the timeline.
+     *
+     * The cost is proportional to the number of segments listed.
+     * @param stop_before       The segments of timelines with this number
+     *      or less are not listed, which allows walking the segments
+     *      shared with another timeline only once.
+     * @return The segments from this timeline leftward, in decreasing
+     *      order of timeline numbers.
+     */
+    std::vector<Segment> Segments(int stop_before = -1) const;
+
+    /**
+     * @brief The size of the blocks needed by an arena for timelines.
+     *
+     * @return The size in bytes of the internal state of a timeline.
+     */
+    static std::size_t arena_block_size() noexcept;
+
     TimeLine(TimeLine const&) = delete;
     TimeLine& operator=(TimeLine const&) = delete;
     TimeLine(TimeLine&&) = default;
@@ -102,14 +221,16 @@ class TimeLine {
     }
 
   private:
-    //Declaring the pimpl idiom with a shared pointer.
+    //Declaring the pimpl idiom with an intrusive pointer.
     ///@cond INTERNAL
     class Impl;
     friend Impl Impl(TimeLine const& left_timeline, int branch_time);
+    // The reference count is not atomic since games are single-threaded
+    friend void intrusive_ptr_add_ref(Impl* pimpl) noexcept;
+    friend void intrusive_ptr_release(Impl* pimpl);
     ///@endcond
 
-    std::shared_ptr<Impl> pimpl_;
-    static void ImplDeleter(Impl* pimpl);
+    boost::intrusive_ptr<Impl> pimpl_;
     void CleanUp();
 };
 }
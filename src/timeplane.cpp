@@ -1,31 +1,95 @@
+#include "moment.hpp"
 #include "timeplane.hpp"
 
 using namespace timeplane;
 
-TimePlane::TimePlane()
-    :second_rightmost_timeline_{boost::none},
-     handlers_(),
-     latest_antitelephone_arrival_{kNoAntitelephoneArrival},
+TimePlane::TimePlane(bool retain_all_timelines, bool defer_cleanup)
+    :retirements_(),
+     arena_{TimeLine::arena_block_size()},
      rightmost_timeline_{
     [this] (MomentIterators iter) {
-        this->MomentDeleterFacade(iter);
-    }} {}
+        this->RecordRetirement(iter);
+    }, &arena_},
+     second_rightmost_timeline_{boost::none},
+     retain_all_timelines_{retain_all_timelines},
+     retained_timelines_(),
+     defer_cleanup_{defer_cleanup},
+     discarded_timelines_(),
+     arrivals_{} {}
 
-TimeLine& TimePlane::MakeNewTimeLine(int branch_time) {
+TimeLine& TimePlane::MakeNewTimeLine(int branch_time, int traveller) {
+    Moment source = rightmost_timeline_.LatestMoment();
     TimeLine new_timeline{
         rightmost_timeline_, branch_time, [this] (MomentIterators iter) {
-            this->MomentDeleterFacade(iter);
+            this->RecordRetirement(iter);
         }};
+    if (retain_all_timelines_ && second_rightmost_timeline_) {
+        // The index is compacted since the timeline is kept for history
+        retained_timelines_.push_back(
+            std::move(second_rightmost_timeline_.get()));
+        retained_timelines_.back().CompactIndex();
+    } else if (defer_cleanup_ && second_rightmost_timeline_) {
+        // Moving the timeline away leaves nothing to clean up for now
+        discarded_timelines_.push_back(
+            std::move(second_rightmost_timeline_.get()));
+    }
     second_rightmost_timeline_ = std::move(rightmost_timeline_);
     rightmost_timeline_ = std::move(new_timeline);
-    if (branch_time > latest_antitelephone_arrival_) {
-        latest_antitelephone_arrival_ = branch_time;
-    }
+    arrivals_.Add(ArrivalIndex::Arrival{
+        branch_time, source, traveller,
+        rightmost_timeline_.timeline_number()});
     return rightmost_timeline_;
 }
 
-void TimePlane::MomentDeleterFacade(MomentIterators iterators) {
-    for (MomentDeleterFn const& handler : handlers_) {
-        handler(iterators);
+TimeLine const& TimePlane::GetTimeLine(int timeline_num) const {
+    int rightmost_num = rightmost_timeline_.timeline_number();
+    if (timeline_num == rightmost_num) {
+        return rightmost_timeline_;
+    }
+    if (timeline_num == rightmost_num - 1 && second_rightmost_timeline_) {
+        return second_rightmost_timeline_.get();
+    }
+    if (timeline_num < 0 || timeline_num >=
+            static_cast<int>(retained_timelines_.size())) {
+        throw std::out_of_range("Timeline is not retained.");
+    }
+    return retained_timelines_[timeline_num];
+}
+
+Moment const TimePlane::GetMoment(int timeline_num, int time) const {
+    return GetTimeLine(timeline_num).GetMoment(time);
+}
+
+bool TimePlane::IsAccessible(Moment m) const {
+    int time = m.time();
+    auto reaches = [m, time] (TimeLine const& timeline) {
+        return time >= 0 && time <= timeline.LatestMoment().time() &&
+               timeline.GetMoment(time) == m;
+    };
+    if (reaches(rightmost_timeline_)) {
+        return true;
+    }
+    if (second_rightmost_timeline_ &&
+            reaches(second_rightmost_timeline_.get())) {
+        return true;
+    }
+    int timeline_num = m.parent_timeline_num();
+    return timeline_num >= 0 && timeline_num <
+           static_cast<int>(retained_timelines_.size()) &&
+           reaches(retained_timelines_[timeline_num]);
+}
+
+void TimePlane::CollectDiscarded() {
+    discarded_timelines_.clear();
+}
+
+void TimePlane::RecordRetirement(MomentIterators iterators) {
+    if (iterators.first == iterators.second) {
+        return;
     }
+    // The moments erased together are consecutive moments of one timeline
+    Moment first = *iterators.first;
+    int count = static_cast<int>(iterators.second - iterators.first);
+    retirements_.Retire(first.parent_timeline_num(), first.time(),
+                        first.time() + count);
 }
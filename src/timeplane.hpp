@@ -6,6 +6,9 @@
 #include <vector>
 #include <boost/optional/optional.hpp>
 #include "aliases.hpp"
+#include "arrivalindex.hpp"
+#include "blockarena.hpp"
+#include "retirementlog.hpp"
 #include "timeline.hpp"
 
 namespace  timeplane {
@@ -17,10 +20,22 @@ class TimeLine;
  *
  * A timeplane can logically be thought of as a sequence of linearly
  * connected timelines spanning left to right (where time flows upward
- * within each timeline). Currently the class allows access to the rightmost
- * and second-rightmost timelines only. The user can register handlers
- * to clean up their data structures whenever any @c Moment instances are
- * no longer externally accessible.
+ * within each timeline). By default the class allows access to the
+ * rightmost and second-rightmost timelines only. Whenever any @c Moment
+ * instances are no longer externally accessible, they are recorded in a
+ * @c RetirementLog, which the user can consult to clean up their data
+ * structures in bulk.
+ *
+ * The fixed-size state of every timeline is allocated from an arena owned
+ * by the instance, so creating and discarding a branch takes one block
+ * from the arena instead of a heap allocation for that state. The moments
+ * of a branch and its index of the moments it shares are still allocated
+ * on the heap, and filling the index takes time linear in the branch time.
+ *
+ * Optionally, every timeline can be retained for the lifetime of the
+ * instance. Timelines share the moments before their branch time with the
+ * timelines to their left, so the memory used grows with the moments that
+ * diverged rather than the full length of every timeline.
  */
 class TimePlane {
   public:
@@ -34,8 +49,12 @@ class TimePlane {
      *
      * A single timeline is created and within it, a single moment
      * is also created.
+     * @param retain_all_timelines      Whether to keep every timeline
+     *      instead of only the two rightmost timelines.
+     * @param defer_cleanup             Whether to postpone cleaning up
+     *      discarded timelines until @c CollectDiscarded is called.
      */
-    TimePlane();
+    TimePlane(bool retain_all_timelines = false, bool defer_cleanup = false);
 
     /**
      * @brief Accessor for the latest Antitelephone arrival time.
@@ -50,7 +69,19 @@ class TimePlane {
      * @return Time of the latest Antitelephone arrival.
      */
     int latest_antitelephone_arrival() const noexcept {
-        return latest_antitelephone_arrival_;
+        return arrivals_.empty() ? kNoAntitelephoneArrival :
+                                   arrivals_.latest_branch_time();
+    }
+
+    /**
+     * @brief Accessor for the index of every Antitelephone arrival.
+     *
+     * Every timeline except the first was created by one arrival, which
+     * remains in the index even once the timeline is discarded.
+     * @return A constant reference to the index of arrivals.
+     */
+    ArrivalIndex const& arrivals() const noexcept {
+        return arrivals_;
     }
 
     /**
@@ -86,35 +117,138 @@ class TimePlane {
         return second_rightmost_timeline_;
     }
 
+    /**
+     * @brief Accessor for whether every timeline is retained.
+     *
+     * @return Whether timelines to the left of the second-rightmost
+     *      timeline are kept.
+     */
+    bool retains_all_timelines() const noexcept {
+        return retain_all_timelines_;
+    }
+
+    /**
+     * @brief Accessor for whether cleaning up timelines is postponed.
+     *
+     * @return Whether discarded timelines are only cleaned up once
+     *      @c CollectDiscarded is called.
+     */
+    bool defers_cleanup() const noexcept {
+        return defer_cleanup_;
+    }
+
+    /**
+     * @brief Accessor for the number of timelines awaiting clean up.
+     *
+     * @return The number of discarded timelines whose moments have not
+     *      been retired yet.
+     */
+    int num_discarded() const noexcept {
+        return static_cast<int>(discarded_timelines_.size());
+    }
+
+    /**
+     * @brief Accessor for the number of timelines created so far.
+     *
+     * @return The number of timelines, which is one more than the
+     *      timeline number of the rightmost timeline.
+     */
+    int num_timelines() const noexcept {
+        return rightmost_timeline_.timeline_number() + 1;
+    }
+
+    /**
+     * @brief Accesses a timeline given its timeline number.
+     *
+     * The reference returned is invalidated once a new timeline is created.
+     * @param timeline_num      The timeline number to query.
+     * @return A constant reference to the timeline.
+     * @throws std::out_of_range If the timeline was not retained.
+     */
+    TimeLine const& GetTimeLine(int timeline_num) const;
+
+    /**
+     * @brief Accesses the moment with the specified timeline and time.
+     *
+     * @param timeline_num      The timeline number to query.
+     * @param time              The time to query.
+     * @return The @c Moment instance at the specified time, as seen
+     *      from the specified timeline.
+     * @throws std::out_of_range If the timeline was not retained, or if
+     *      no moment exists at the specified time.
+     */
+    Moment const GetMoment(int timeline_num, int time) const;
+
+    /**
+     * @brief Checks whether a moment is externally accessible.
+     *
+     * A moment is accessible if it can be reached from any timeline that
+     * has not been discarded, even if it has not been retired yet.
+     * @param m     The moment to query.
+     * @return Whether the moment is accessible.
+     */
+    bool IsAccessible(Moment m) const;
+
     /**
      * @brief Creates a new timeline branching from the rightmost timeline.
      *
      * The reference returned is invalidated once a new timeline is created.
      * @param branch_time       The time of the branch, which will be the
      *      the time of the sole moment available in the new timeline.
+     * @param traveller         The ID of the player whose arrival creates
+     *      the timeline, if known.
      * @return A reference to the newly created timeline.
      */
-    TimeLine& MakeNewTimeLine(int branch_time);
+    TimeLine& MakeNewTimeLine(
+        int branch_time, int traveller = ArrivalIndex::kUnknownTraveller);
+
+    /**
+     * @brief Cleans up every discarded timeline whose clean up was deferred.
+     *
+     * The moments no longer accessible are then recorded as retired.
+     */
+    void CollectDiscarded();
+
+    /**
+     * @brief Accessor for the log of retired moments.
+     *
+     * Moments are retired once they are no longer externally accessible.
+     * Data associated with them can then be reclaimed using the log.
+     * @return A constant reference to the log of retired moments.
+     */
+    RetirementLog const& retirements() const noexcept {
+        return retirements_;
+    }
 
     /**
-     * @brief Registers a moment deletion handler.
+     * @brief Lists the segments holding every moment not yet erased.
      *
-     * The moment deletion handler is called with a pair of output iterators
-     * denoting @c Moment instances that are no longer externally accessible.
-     * @param handler       The moment deletion handler to register.
+     * Every timeline kept by the instance branches off from the timelines
+     * to its left, so the segments are those reached from the rightmost
+     * timeline. The cost is proportional to the number of timelines.
+     * @return The segments in decreasing order of timeline numbers.
      */
-    void RegisterMomentDeleter(MomentDeleterFn handler) {
-        handlers_.push_back(std::move(handler));
+    std::vector<TimeLine::Segment> Segments() const {
+        return rightmost_timeline_.Segments();
     }
 
   private:
+    // Declared first since the timelines record retirements when destroyed
+    RetirementLog retirements_;
+    // Holds the internal state of every timeline, so it must outlive them
+    BlockArena arena_;
     TimeLine rightmost_timeline_;
     boost::optional<TimeLine> second_rightmost_timeline_;
-    std::vector<MomentDeleterFn> handlers_;
-    int latest_antitelephone_arrival_;
+    bool retain_all_timelines_;
+    // Timelines left of the second rightmost, indexed by timeline number
+    std::vector<TimeLine> retained_timelines_;
+    bool defer_cleanup_;
+    // Timelines that were discarded but not cleaned up yet
+    std::vector<TimeLine> discarded_timelines_;
+    ArrivalIndex arrivals_;
 
-    /* Calls all the moment deletion handlers. */
-    void MomentDeleterFacade(MomentIterators iterators);
+    /* Records the moments erased by a timeline as retired. */
+    void RecordRetirement(MomentIterators iterators);
 };
 }
 
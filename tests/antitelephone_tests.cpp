@@ -1,10 +1,12 @@
 #include "catch/include/catch.hpp"
 
+#include <atomic>
 #include <sstream>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <regex>
+#include <thread>
 #include <boost/iostreams/tee.hpp>
 #include <boost/iostreams/stream.hpp>
 #include <boost/optional.hpp>
@@ -12,11 +14,16 @@
 #include "../src/momentoverview.hpp"
 #include "../src/movedata.hpp"
 
+#include "../src/divergenceindex.hpp"
+#include "../src/playerhistory.hpp"
 #include "../src/roundinfo.hpp"
 #include "../src/roundinfoview.hpp"
 
 #include "../src/itemsutil.hpp"
 
+#include "../src/gamesnapshot.hpp"
+#include "../src/memoryreport.hpp"
+#include "../src/momentfeed.hpp"
 #include "../src/queryresult.hpp"
 #include "../src/aliases.hpp"
 
@@ -229,7 +236,8 @@ MoveData CollectMoveData() {
 }
 
 // Runs the game through the framework
-void RunGameEngine() {
+void RunGameEngine(bool defer_cleanup = false,
+                   int spill_horizon = AntitelephoneGame::kNoSpillHorizon) {
     int num_players = 0;
     std::string line;
     out << "NUMBER OF PLAYERS?" << std::endl;
@@ -276,7 +284,8 @@ void RunGameEngine() {
         running = false;
     };
 
-    AntitelephoneGame game{42, num_players};
+    AntitelephoneGame game{42, num_players, 1337133713371337UL,
+                           false, defer_cleanup, spill_horizon};
     game.RegisterNewRoundHandler(round_handler);
     game.RegisterTravelHandler(travel_handler);
     game.RegisterEndGameHandler(end_handler);
@@ -347,6 +356,11 @@ void RunGameEngine() {
                 ShowQueryResult(result);
             }
         }
+        // Deferred clean up only happens between rounds
+        if (defer_cleanup && antiplayer == -1) {
+            game.Collect();
+            REQUIRE(tp.num_discarded() == 0);
+        }
     }
     out << "GAME END" << std::endl << std::endl;
 }
@@ -383,9 +397,23 @@ TEST_CASE("Antitelephone test " case_str, "[game_all]") {\
     suffix += ".txt";\
     std::string in_path = test_files_path + "input" + suffix;\
     std::string out_path = test_files_path + "output" + suffix;\
-    if(SetupIO(in_path, out_path)) {\
-        RunGameEngine();\
-        CompareOutputWithReference();\
+    SECTION("Immediate clean up") {\
+        if(SetupIO(in_path, out_path)) {\
+            RunGameEngine();\
+            CompareOutputWithReference();\
+        }\
+    }\
+    SECTION("Deferred clean up") {\
+        if(SetupIO(in_path, out_path)) {\
+            RunGameEngine(true);\
+            CompareOutputWithReference();\
+        }\
+    }\
+    SECTION("Spilled moments") {\
+        if(SetupIO(in_path, out_path)) {\
+            RunGameEngine(false, 0);\
+            CompareOutputWithReference();\
+        }\
     }\
 }
 
@@ -396,6 +424,417 @@ ANTI_TEST("3")
 ANTI_TEST("4")
 ANTI_TEST("5")
 
+TEST_CASE("Antitelephone memory report", "[game_all]") {
+    int constexpr kRounds = 20;
+    AntitelephoneGame game{42, 2, 1337133713371337UL, false, false, 4, true};
+    for (int round = 0; round < kRounds; round++) {
+        // The players never meet, so the game goes on
+        for (int player = 0; player < 2; player++) {
+            MoveData move{};
+            move.set_new_location(player);
+            REQUIRE(game.MakeRegularMove(player, move));
+        }
+    }
+    MoveData move{};
+    move.set_new_location(0);
+    REQUIRE(game.MakeRegularMove(0, move));
+
+    MemoryReport report = game.memory_report();
+    REQUIRE(report.segments.size() == 1);
+    REQUIRE(report.num_live_moments == kRounds + 1);
+    REQUIRE(report.round_info.num_entries == kRounds + 1);
+    // Moments more than 4 rounds behind the latest one are spilled
+    REQUIRE(report.round_info.num_spilled == kRounds - 4);
+    REQUIRE(report.round_info.bytes > 0);
+    REQUIRE(report.moves_info.num_entries + report.num_pruned == kRounds);
+    REQUIRE(report.moves_pending.num_entries == 1);
+    REQUIRE(report.item_states.num_entries == kRounds + 1);
+    REQUIRE(report.item_states.num_spilled == kRounds - 4);
+    REQUIRE(report.snapshot_records.num_entries == kRounds + 1);
+    REQUIRE(report.snapshot_records.num_spilled == kRounds - 4);
+    REQUIRE(report.num_retired == 0);
+    REQUIRE(report.num_reclaimed == 0);
+    REQUIRE(report.spill_file_bytes > 0);
+
+    // The history of spilled moments stays in RAM
+    REQUIRE(report.player_history.num_entries == kRounds + 1);
+    REQUIRE(report.player_history.num_spilled == 0);
+    PlayerHistory const& history = game.player_history();
+    for (int time = 1; time <= kRounds; time++) {
+        REQUIRE(history.Location(Moment{0, time}, 0) == 0);
+        REQUIRE(history.Location(Moment{0, time}, 1) == 1);
+    }
+
+    // Snapshots read spilled records back
+    std::shared_ptr<GameSnapshot const> snapshot = game.snapshot();
+    for (int time = 0; time <= kRounds; time++) {
+        MomentOverview expected =
+            game.GetOverview(1, Moment{0, time}).second.get();
+        MomentOverview overview =
+            snapshot->GetOverview(1, Moment{0, time}).second.get();
+        REQUIRE(overview.round_info().Location(1) ==
+                expected.round_info().Location(1));
+        for (int i = 0; i < ItemTypeCount; i++) {
+            REQUIRE(overview.ItemStateTags(i) == expected.ItemStateTags(i));
+        }
+    }
+}
+
+TEST_CASE("Antitelephone travel restores the destination", "[game_all]") {
+    int constexpr kAntitelephone = ItemTypeID(ItemType::kAntitelephone);
+    int constexpr kBridge = ItemTypeID(ItemType::kBridge);
+    AntitelephoneGame game{42, 2};
+    int antiplayer = -1;
+    game.RegisterTravelHandler([&antiplayer] (int, int player) {
+        antiplayer = player;
+    });
+    TimePlane const& tp = game.time_plane();
+
+    // Player 0 unlocks and activates the Bridge, keeps it active and
+    // then charges the Antitelephone, while player 1 stays away
+    auto play_round = [&game] (int bridge_energy, int antitelephone_energy) {
+        MoveData move{};
+        move.set_new_location(0);
+        move.SetEnergyInput(kBridge, bridge_energy);
+        move.SetEnergyInput(kAntitelephone, antitelephone_energy);
+        REQUIRE(game.MakeRegularMove(0, move));
+        MoveData other_move{};
+        other_move.set_new_location(1);
+        REQUIRE(game.MakeRegularMove(1, other_move));
+    };
+    for (int time = 0; time < 18; time++) {
+        play_round(3, 0);
+    }
+    for (int time = 18; time < 23; time++) {
+        play_round(1, 0);
+    }
+    while (antiplayer == -1) {
+        play_round(1, 2);
+    }
+    REQUIRE(antiplayer == 0);
+    REQUIRE(tp.rightmost_timeline().LatestMoment().time() == 27);
+
+    // Moments at multiples of 8 have keyframes, the others do not
+    int dest_time = GENERATE(24, 25);
+    Moment dest = tp.rightmost_timeline().GetMoment(dest_time);
+    MomentOverview before = game.GetOverview(1, dest).second.get();
+    MomentFeed::Reader reader = game.moment_feed().Subscribe();
+    REQUIRE(game.MakeAntitelephoneMove(0, dest_time));
+    Moment new_moment = tp.rightmost_timeline().LatestMoment();
+    REQUIRE(new_moment.time() == dest_time);
+    REQUIRE(new_moment.parent_timeline_num() == 1);
+    MomentEvent event{};
+    REQUIRE(reader.TryNext(event));
+    REQUIRE(event.moment == new_moment);
+    REQUIRE(event.new_timeline);
+    REQUIRE(event.active == 0x1);
+    REQUIRE_FALSE(reader.TryNext(event));
+    REQUIRE(tp.arrivals().size() == 1);
+    REQUIRE(tp.arrivals().begin()->source == Moment{0, 27});
+    REQUIRE(tp.arrivals().begin()->traveller == 0);
+    REQUIRE(tp.latest_antitelephone_arrival() == dest_time);
+
+    MomentOverview after = game.GetOverview(1, new_moment).second.get();
+    REQUIRE(after.effect().attack_increase() ==
+            before.effect().attack_increase());
+    REQUIRE(after.effect().max_hitpoint_increase() ==
+            before.effect().max_hitpoint_increase());
+    for (int i = 0; i < ItemTypeCount; i++) {
+        REQUIRE(after.ItemState(i) == before.ItemState(i));
+    }
+    REQUIRE_FALSE(after.round_info().active());
+
+    // The moves of player 1 are replayed in the new timeline
+    play_round(1, 0);
+    play_round(1, 0);
+    REQUIRE(tp.rightmost_timeline().LatestMoment().time() == dest_time + 2);
+}
+
+TEST_CASE("Antitelephone travel picks a departing player", "[game_all]") {
+    int constexpr kAntitelephone = ItemTypeID(ItemType::kAntitelephone);
+    int constexpr kBridge = ItemTypeID(ItemType::kBridge);
+    int constexpr kNumPlayers = 3;
+    std::vector<int> num_picked(kNumPlayers, 0);
+    for (uint64_t seed = 0; seed < 16; seed++) {
+        AntitelephoneGame game{42, kNumPlayers, seed};
+        int antiplayer = -1;
+        game.RegisterTravelHandler([&antiplayer] (int, int player) {
+            antiplayer = player;
+        });
+
+        // Players 0 and 1 charge the Antitelephone in lockstep, so they
+        // depart in the same round, while player 2 never does
+        auto play_round = [&game] (int bridge_energy,
+                                   int antitelephone_energy) {
+            for (int player = 0; player < kNumPlayers; player++) {
+                MoveData move{};
+                move.set_new_location(player);
+                if (player != 2) {
+                    move.SetEnergyInput(kBridge, bridge_energy);
+                    move.SetEnergyInput(kAntitelephone,
+                                        antitelephone_energy);
+                }
+                REQUIRE(game.MakeRegularMove(player, move));
+            }
+        };
+        for (int time = 0; time < 18; time++) {
+            play_round(3, 0);
+        }
+        for (int time = 18; time < 23; time++) {
+            play_round(1, 0);
+        }
+        while (antiplayer == -1) {
+            play_round(1, 2);
+        }
+        REQUIRE((antiplayer == 0 || antiplayer == 1));
+        num_picked[antiplayer]++;
+    }
+    // Either departing player may be picked
+    REQUIRE(num_picked[0] > 0);
+    REQUIRE(num_picked[1] > 0);
+}
+
+TEST_CASE("Antitelephone travel restores every item", "[game_all]") {
+    int constexpr kAntitelephone = ItemTypeID(ItemType::kAntitelephone);
+    int constexpr kBridge = ItemTypeID(ItemType::kBridge);
+    int constexpr kOracle = ItemTypeID(ItemType::kOracle);
+    int constexpr kShield = ItemTypeID(ItemType::kShield);
+    int constexpr kNumPlayers = 3;
+    AntitelephoneGame game{42, kNumPlayers};
+    int antiplayer = -1;
+    game.RegisterTravelHandler([&antiplayer] (int, int player) {
+        antiplayer = player;
+    });
+    TimePlane const& tp = game.time_plane();
+
+    // Player 0 charges the Antitelephone, while the others put energy
+    // into different items so that each of their items has its own state
+    auto play_round = [&game] (int bridge_energy, int antitelephone_energy) {
+        MoveData move{};
+        move.set_new_location(0);
+        move.SetEnergyInput(kBridge, bridge_energy);
+        move.SetEnergyInput(kAntitelephone, antitelephone_energy);
+        REQUIRE(game.MakeRegularMove(0, move));
+        MoveData shield_move{};
+        shield_move.set_new_location(1);
+        shield_move.SetEnergyInput(kShield, 2);
+        REQUIRE(game.MakeRegularMove(1, shield_move));
+        MoveData oracle_move{};
+        oracle_move.set_new_location(2);
+        oracle_move.SetEnergyInput(kOracle, 1);
+        oracle_move.SetEnergyInput(kBridge, 2);
+        REQUIRE(game.MakeRegularMove(2, oracle_move));
+    };
+    for (int time = 0; time < 18; time++) {
+        play_round(3, 0);
+    }
+    for (int time = 18; time < 23; time++) {
+        play_round(1, 0);
+    }
+    while (antiplayer == -1) {
+        play_round(1, 2);
+    }
+    REQUIRE(antiplayer == 0);
+
+    // Moments at multiples of 8 have keyframes, the others do not
+    int dest_time = GENERATE(24, 25);
+    Moment dest = tp.rightmost_timeline().GetMoment(dest_time);
+    std::vector<MomentOverview> before;
+    for (int player = 1; player < kNumPlayers; player++) {
+        before.push_back(game.GetOverview(player, dest).second.get());
+    }
+    REQUIRE(game.MakeAntitelephoneMove(0, dest_time));
+    Moment new_moment = tp.rightmost_timeline().LatestMoment();
+    for (int player = 1; player < kNumPlayers; player++) {
+        MomentOverview after =
+            game.GetOverview(player, new_moment).second.get();
+        for (int i = 0; i < ItemTypeCount; i++) {
+            REQUIRE(after.ItemStateTags(i) ==
+                    before[player - 1].ItemStateTags(i));
+        }
+    }
+}
+
+TEST_CASE("Antitelephone familiar encounters", "[game_all]") {
+    int constexpr kAntitelephone = ItemTypeID(ItemType::kAntitelephone);
+    int constexpr kBridge = ItemTypeID(ItemType::kBridge);
+    AntitelephoneGame game{42, 2};
+    int antiplayer = -1;
+    game.RegisterTravelHandler([&antiplayer] (int, int player) {
+        antiplayer = player;
+    });
+    TimePlane const& tp = game.time_plane();
+
+    // Player 0 charges the Antitelephone while player 1 stays away
+    auto play_round = [&game] (int location, int bridge_energy,
+                               int antitelephone_energy) {
+        MoveData move{};
+        move.set_new_location(location);
+        move.SetEnergyInput(kBridge, bridge_energy);
+        move.SetEnergyInput(kAntitelephone, antitelephone_energy);
+        REQUIRE(game.MakeRegularMove(0, move));
+        MoveData other_move{};
+        other_move.set_new_location(1);
+        REQUIRE(game.MakeRegularMove(1, other_move));
+    };
+    for (int time = 0; time < 18; time++) {
+        play_round(0, 3, 0);
+    }
+    for (int time = 18; time < 23; time++) {
+        play_round(0, 1, 0);
+    }
+    while (antiplayer == -1) {
+        play_round(0, 1, 2);
+    }
+    REQUIRE(game.MakeAntitelephoneMove(0, 24));
+    Moment arrival = tp.rightmost_timeline().LatestMoment();
+    int attack = game.GetOverview(0, arrival).second->effect()
+                 .attack_increase();
+
+    SECTION("Alone") {
+        // The antiplayer meets nobody, so there is no bonus to consider
+        play_round(0, 1, 0);
+        Moment m = tp.rightmost_timeline().LatestMoment();
+        REQUIRE(m.time() == 25);
+        for (int player = 0; player < 2; player++) {
+            REQUIRE(game.GetOverview(player, m).second->round_info()
+                    .DamageReceived(player) == 0);
+        }
+    }
+    SECTION("Meets an inactive player") {
+        // Player 1 still replays the older timeline, so the antiplayer
+        // strikes with the bonus
+        play_round(1, 1, 0);
+        Moment m = tp.rightmost_timeline().LatestMoment();
+        REQUIRE(m.time() == 25);
+        REQUIRE(game.GetOverview(1, m).second->round_info()
+                .DamageReceived(1) ==
+                (int)(attack *
+                      AntitelephoneGame::kFamiliarEncounterMultiplier));
+    }
+}
+
+TEST_CASE("Antitelephone divergence", "[game_all]") {
+    int constexpr kAntitelephone = ItemTypeID(ItemType::kAntitelephone);
+    int constexpr kBridge = ItemTypeID(ItemType::kBridge);
+    AntitelephoneGame game{42, 2};
+    int antiplayer = -1;
+    game.RegisterTravelHandler([&antiplayer] (int, int player) {
+        antiplayer = player;
+    });
+    TimePlane const& tp = game.time_plane();
+    DivergenceIndex const& divergence = game.divergence_index();
+
+    // Player 0 charges the Antitelephone while player 1 stays away
+    auto play_round = [&game] (int location, int bridge_energy,
+                               int antitelephone_energy) {
+        MoveData move{};
+        move.set_new_location(location);
+        move.SetEnergyInput(kBridge, bridge_energy);
+        move.SetEnergyInput(kAntitelephone, antitelephone_energy);
+        REQUIRE(game.MakeRegularMove(0, move));
+        MoveData other_move{};
+        other_move.set_new_location(1);
+        REQUIRE(game.MakeRegularMove(1, other_move));
+    };
+    for (int time = 0; time < 18; time++) {
+        play_round(0, 3, 0);
+    }
+    for (int time = 18; time < 23; time++) {
+        play_round(0, 1, 0);
+    }
+    while (antiplayer == -1) {
+        play_round(0, 1, 2);
+    }
+    int const dest_time = 24;
+    REQUIRE(game.MakeAntitelephoneMove(0, dest_time));
+
+    // Nobody meets anyone else in either timeline
+    play_round(0, 1, 0);
+    REQUIRE(tp.rightmost_timeline().LatestMoment().time() == dest_time + 1);
+    REQUIRE(divergence.diverged() == 0);
+    REQUIRE(divergence.first_divergence(1) == DivergenceIndex::kNotDiverged);
+
+    // Player 0 now joins player 1, who was alone in the older timeline,
+    // while player 0 meets whoever stood there before
+    play_round(1, 1, 0);
+    REQUIRE(divergence.diverged() == 0x2);
+    REQUIRE(divergence.first_divergence(0) == DivergenceIndex::kNotDiverged);
+    REQUIRE(divergence.first_divergence(1) == dest_time + 2);
+}
+
+TEST_CASE("Antitelephone snapshots", "[game_all]") {
+    // Nothing is recorded for snapshots unless they are published
+    AntitelephoneGame unpublished{42, 2};
+    REQUIRE(unpublished.snapshot() == nullptr);
+    REQUIRE(unpublished.memory_report().snapshot_records.num_entries == 0);
+
+    AntitelephoneGame game{42, 2, 1337133713371337UL, false, false,
+                           AntitelephoneGame::kNoSpillHorizon, true};
+    auto play_round = [&game] () {
+        for (int player = 0; player < 2; player++) {
+            MoveData move{};
+            move.set_new_location(player);
+            REQUIRE(game.MakeRegularMove(player, move));
+        }
+    };
+    std::shared_ptr<GameSnapshot const> first = game.snapshot();
+    REQUIRE(first->latest_moment() == Moment{0, 0});
+    play_round();
+    play_round();
+
+    // Old snapshots are unaffected by later rounds
+    std::shared_ptr<GameSnapshot const> latest = game.snapshot();
+    REQUIRE(first->num_moments() == 1);
+    REQUIRE_FALSE(first->GetOverview(0, Moment{0, 1}).first);
+    REQUIRE(latest->latest_moment() == Moment{0, 2});
+    REQUIRE(latest->num_moments() == 3);
+    REQUIRE_FALSE(latest->GetOverview(2, Moment{0, 1}).first);
+    REQUIRE_FALSE(latest->GetOverview(0, Moment{0, 3}).first);
+
+    // Snapshots answer the same as the game itself
+    for (int time = 0; time <= 2; time++) {
+        for (int player = 0; player < 2; player++) {
+            auto expected = game.GetOverview(player, Moment{0, time});
+            auto actual = latest->GetOverview(player, Moment{0, time});
+            REQUIRE(actual.first);
+            MomentOverview const& e = expected.second.get();
+            MomentOverview const& a = actual.second.get();
+            REQUIRE(a.moment() == e.moment());
+            REQUIRE(a.player() == e.player());
+            REQUIRE(a.effect().attack_increase() ==
+                    e.effect().attack_increase());
+            REQUIRE(a.round_info().Location(player) ==
+                    e.round_info().Location(player));
+            for (int i = 0; i < ItemTypeCount; i++) {
+                REQUIRE(a.ItemState(i) == e.ItemState(i));
+            }
+        }
+    }
+
+    // Readers on other threads never see a round in progress
+    std::atomic<bool> done{false};
+    std::atomic<int> num_bad{0};
+    std::thread reader{[&game, &done, &num_bad] () {
+        while (!done) {
+            std::shared_ptr<GameSnapshot const> snapshot = game.snapshot();
+            Moment m = snapshot->latest_moment();
+            auto result = snapshot->GetOverview(1, m);
+            if (!result.first || !(result.second->moment() == m) ||
+                    result.second->round_info().Location(1) != 1) {
+                num_bad++;
+            }
+        }
+    }};
+    for (int round = 0; round < 50; round++) {
+        play_round();
+    }
+    done = true;
+    reader.join();
+    REQUIRE(num_bad == 0);
+    REQUIRE(game.snapshot()->latest_moment().time() == 52);
+}
+
 // Dedicated interactive mode of the game
 #ifdef TEST_INTERACTIVE
 TEST_CASE("Antitelephone test interactive", "[game_all]") {
@@ -0,0 +1,353 @@
+#include "catch/include/catch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "../src/blockarena.hpp"
+#include "../src/moment.hpp"
+#include "../src/momentmap.hpp"
+#include "../src/momentstore.hpp"
+#include "../src/retirementlog.hpp"
+#include "../src/spillfile.hpp"
+#include "../src/tieredmomentmap.hpp"
+#include "../src/timeline.hpp"
+#include "../src/timeplane.hpp"
+#include "../src/itemproperties.hpp"
+
+using namespace timeplane;
+
+// Benchmarks are hidden from a regular test run. Run them explicitly
+// with the [benchmark] tag, preferably in a release build.
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// Runs the function the specified number of times and returns the
+// average duration of a single run in nanoseconds.
+template <typename Fn>
+double AverageNanoseconds(int runs, Fn&& fn) {
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < runs; i++) {
+        fn(i);
+    }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    return elapsed.count() / runs;
+}
+
+// Prints one row of a benchmark table.
+void ShowRow(char const* name, int param, double baseline, double result) {
+    std::cout << std::left << std::setw(32) << name;
+    std::cout << std::right << std::setw(8) << param;
+    std::cout << std::setw(14) << std::fixed << std::setprecision(2);
+    std::cout << baseline << std::setw(14) << result << std::endl;
+}
+
+// Prints the header of a benchmark table.
+void ShowHeader(char const* param_name) {
+    std::cout << std::left << std::setw(32) << "BENCHMARK";
+    std::cout << std::right << std::setw(8) << param_name;
+    std::cout << std::setw(14) << "BASELINE ns" << std::setw(14);
+    std::cout << "CURRENT ns" << std::endl;
+}
+
+// Replica of the recursive timeline lookup that walks every branch.
+struct RecursiveTimeLine {
+    std::shared_ptr<RecursiveTimeLine> left_timeline;
+    int branch_time;
+    std::vector<Moment> moments;
+
+    Moment GetMoment(int time) const {
+        if (time < branch_time && left_timeline) {
+            return left_timeline->GetMoment(time);
+        }
+        return moments.at(time - branch_time);
+    }
+};
+}
+
+TEST_CASE("TimeLine lookup benchmark", "[.benchmark]") {
+    int constexpr kLookups = 200000;
+    int volatile sink = 0;
+    ShowHeader("DEPTH");
+
+    for (int depth: {1, 10, 100, 1000}) {
+        // Every branch occurs one moment after the previous branch,
+        // so the moment at time 0 is owned by the deepest ancestor.
+        auto recursive = std::make_shared<RecursiveTimeLine>();
+        recursive->branch_time = 0;
+        recursive->moments.emplace_back(0, 0);
+        std::unique_ptr<TimeLine> timeline = std::make_unique<TimeLine>();
+        for (int i = 0; i < depth; i++) {
+            recursive->moments.emplace_back(i, i + 1);
+            auto next = std::make_shared<RecursiveTimeLine>();
+            next->left_timeline = recursive;
+            next->branch_time = i + 1;
+            next->moments.emplace_back(i + 1, i + 1);
+            recursive = next;
+
+            timeline->MakeMoment();
+            timeline.reset(new TimeLine{*timeline, i + 1});
+        }
+
+        double baseline = AverageNanoseconds(kLookups, [&] (int i) {
+            sink += recursive->GetMoment(i % (depth + 1)).time();
+        });
+        double result = AverageNanoseconds(kLookups, [&] (int i) {
+            sink += timeline->GetMoment(i % (depth + 1)).time();
+        });
+        ShowRow("TimeLine::GetMoment", depth, baseline, result);
+
+        for (int i = 0; i <= depth; i++) {
+            REQUIRE(timeline->GetMoment(i) == recursive->GetMoment(i));
+        }
+    }
+}
+
+TEST_CASE("MomentMap benchmark", "[.benchmark]") {
+    using item::ItemProperties;
+    int constexpr kTimelines = 8;
+    int volatile sink = 0;
+    ItemProperties properties{};
+    properties.set_lockdown(45);
+    properties.set_cooldown(4);
+    properties.set_custom(0, -1);
+    ShowHeader("SIZE");
+
+    for (int timeline_length: {125, 1250, 12500}) {
+        int size = kTimelines * timeline_length;
+        std::vector<Moment> moments;
+        for (int i = 0; i < size; i++) {
+            moments.emplace_back(i % kTimelines, i / kTimelines);
+        }
+        // The latter half of every timeline is erased
+        std::vector<MomentStore> erased(kTimelines);
+        for (int i = 0; i < kTimelines; i++) {
+            for (int t = timeline_length / 2; t < timeline_length; t++) {
+                erased[i].push_back(Moment{i, t});
+            }
+        }
+
+        std::unordered_map<Moment, ItemProperties> baseline_map;
+        MomentMap<ItemProperties> map;
+        double baseline = AverageNanoseconds(size, [&] (int i) {
+            baseline_map.emplace(moments[i], properties);
+        });
+        double result = AverageNanoseconds(size, [&] (int i) {
+            map.emplace(moments[i], properties);
+        });
+        ShowRow("MomentMap insert", size, baseline, result);
+
+        baseline = AverageNanoseconds(4 * size, [&] (int i) {
+            sink += baseline_map.at(moments[(i * 7919LL) % size]).lockdown();
+        });
+        result = AverageNanoseconds(4 * size, [&] (int i) {
+            sink += map.at(moments[(i * 7919LL) % size]).lockdown();
+        });
+        ShowRow("MomentMap lookup", size, baseline, result);
+
+        baseline = AverageNanoseconds(kTimelines, [&] (int i) {
+            std::for_each(erased[i].cbegin(), erased[i].cend(),
+            [&baseline_map] (Moment m) {
+                baseline_map.erase(m);
+            });
+        });
+        result = AverageNanoseconds(kTimelines, [&] (int i) {
+            map.erase(std::make_pair(erased[i].cbegin(), erased[i].cend()));
+        });
+        ShowRow("MomentMap erase range", size, baseline, result);
+
+        REQUIRE(static_cast<int>(baseline_map.size()) == map.size());
+    }
+}
+
+TEST_CASE("Moment reclamation benchmark", "[.benchmark]") {
+    using item::ItemProperties;
+    // The stores of 6 players with 4 items each, plus the game itself
+    int constexpr kStores = 25;
+    int constexpr kTimelines = 64;
+    ShowHeader("RETIRED");
+
+    for (int timeline_length: {8, 64, 512}) {
+        std::vector<MomentMap<ItemProperties>> baseline_stores(kStores);
+        std::vector<MomentMap<ItemProperties>> stores(kStores);
+        for (int i = 0; i < kStores; i++) {
+            for (int timeline = 0; timeline < kTimelines; timeline++) {
+                for (int time = 0; time < timeline_length; time++) {
+                    baseline_stores[i].emplace(Moment{timeline, time});
+                    stores[i].emplace(Moment{timeline, time});
+                }
+            }
+        }
+        // The latter half of every timeline is retired, one at a time
+        int retired = timeline_length / 2;
+        std::vector<MomentStore> erased(kTimelines);
+        for (int timeline = 0; timeline < kTimelines; timeline++) {
+            for (int time = retired; time < timeline_length; time++) {
+                erased[timeline].push_back(Moment{timeline, time});
+            }
+        }
+
+        // Replica of calling one deletion handler for every store
+        std::vector<MomentDeleterFn> handlers;
+        for (MomentMap<ItemProperties>& store: baseline_stores) {
+            handlers.push_back([&store] (MomentIterators iterators) {
+                store.erase(iterators);
+            });
+        }
+        double baseline = AverageNanoseconds(kTimelines, [&] (int i) {
+            MomentIterators iterators =
+                std::make_pair(erased[i].cbegin(), erased[i].cend());
+            for (MomentDeleterFn const& handler: handlers) {
+                handler(iterators);
+            }
+        });
+
+        RetirementLog log{};
+        int epoch = 0;
+        double result = AverageNanoseconds(kTimelines, [&] (int i) {
+            log.Retire(i, retired, timeline_length);
+            for (MomentMap<ItemProperties>& store: stores) {
+                store.Reclaim(log, epoch);
+            }
+            epoch = log.epoch();
+        });
+        ShowRow("Reclaim per retirement", retired, baseline, result);
+
+        for (int i = 0; i < kStores; i++) {
+            REQUIRE(stores[i].size() == baseline_stores[i].size());
+        }
+    }
+}
+
+TEST_CASE("TimeLine branching benchmark", "[.benchmark]") {
+    int constexpr kBranches = 100000;
+    ShowHeader("LENGTH");
+
+    for (int timeline_length: {1, 8, 64}) {
+        // Every branch replaces the older of the two rightmost timelines
+        auto branch_repeatedly = [timeline_length] (BlockArena* arena) {
+            TimeLine rightmost{MomentDeleterFn{}, arena};
+            TimeLine second_rightmost{MomentDeleterFn{}, arena};
+            return AverageNanoseconds(kBranches, [&] (int) {
+                while (rightmost.LatestMoment().time() < timeline_length) {
+                    rightmost.MakeMoment();
+                }
+                TimeLine new_timeline{rightmost, timeline_length / 2};
+                second_rightmost = std::move(rightmost);
+                rightmost = std::move(new_timeline);
+            });
+        };
+        double baseline = branch_repeatedly(nullptr);
+        BlockArena arena{TimeLine::arena_block_size()};
+        double result = branch_repeatedly(&arena);
+        ShowRow("TimePlane::MakeNewTimeLine", timeline_length,
+                baseline, result);
+        REQUIRE(arena.num_allocated() == 0);
+    }
+}
+
+TEST_CASE("Deferred clean up benchmark", "[.benchmark]") {
+    int constexpr kBranches = 2000;
+    ShowHeader("LENGTH");
+
+    for (int timeline_length: {8, 64, 512}) {
+        // Only the time spent branching is measured
+        auto branch_latency = [timeline_length] (bool defer_cleanup) {
+            TimePlane tp{false, defer_cleanup};
+            std::chrono::duration<double, std::nano> elapsed{0};
+            for (int i = 0; i < kBranches; i++) {
+                while (tp.rightmost_timeline().LatestMoment().time() <
+                        timeline_length) {
+                    tp.rightmost_timeline().MakeMoment();
+                }
+                Clock::time_point start = Clock::now();
+                tp.MakeNewTimeLine(1);
+                elapsed += Clock::now() - start;
+                if (i % 16 == 0) {
+                    tp.CollectDiscarded();
+                }
+            }
+            return elapsed.count() / kBranches;
+        };
+        double baseline = branch_latency(false);
+        double result = branch_latency(true);
+        ShowRow("TimePlane::MakeNewTimeLine", timeline_length,
+                baseline, result);
+    }
+}
+
+TEST_CASE("Spilled moment lookup benchmark", "[.benchmark]") {
+    using item::ItemProperties;
+    int constexpr kLookups = 20000;
+    ShowHeader("MOMENTS");
+
+    for (int num_moments: {1000, 100000}) {
+        ItemProperties properties{};
+        properties.set_lockdown(2);
+        properties.set_cooldown(3);
+        properties.set_custom(0, 5);
+        MomentMap<ItemProperties> hot{};
+        TieredMomentMap<ItemProperties> tiered{};
+        for (int i = 0; i < num_moments; i++) {
+            hot.emplace(Moment{0, i}, properties);
+            tiered.emplace(Moment{0, i}, properties);
+        }
+        SpillFile file{};
+        tiered.Spill(file, num_moments);
+
+        int sum = 0;
+        double baseline = AverageNanoseconds(kLookups, [&] (int i) {
+            sum += hot.at(Moment{0, (i * 7919) % num_moments}).cooldown();
+        });
+        // Every lookup reads a value back from the file
+        double result = AverageNanoseconds(kLookups, [&] (int i) {
+            if (i % 64 == 0) {
+                tiered.Spill(file, 0);
+            }
+            sum += tiered.at(Moment{0, (i * 7919) % num_moments}).cooldown();
+        });
+        REQUIRE(sum == 6 * kLookups);
+        ShowRow("TieredMomentMap::at, spilled", num_moments,
+                baseline, result);
+    }
+}
+
+TEST_CASE("TimeLine range benchmark", "[.benchmark]") {
+    int constexpr kLength = 4096;
+    int constexpr kRuns = 200;
+    int volatile sink = 0;
+    ShowHeader("BRANCHES");
+
+    for (int num_branches: {1, 16, 256}) {
+        // The branches are spread evenly over the timeline
+        std::unique_ptr<TimeLine> timeline = std::make_unique<TimeLine>();
+        int step = kLength / num_branches;
+        for (int i = 1; i < kLength; i++) {
+            timeline->MakeMoment();
+            if (i % step == 0) {
+                timeline.reset(new TimeLine{*timeline, i});
+            }
+        }
+
+        double baseline = AverageNanoseconds(kRuns, [&] (int) {
+            for (int time = 0; time < kLength; time++) {
+                sink += timeline->GetMoment(time).parent_timeline_num();
+            }
+        });
+        double result = AverageNanoseconds(kRuns, [&] (int) {
+            for (TimeLine::Span const& span:
+                    timeline->GetMoments(0, kLength)) {
+                for (int time = span.begin_time; time < span.end_time;
+                        time++) {
+                    sink += span[time].parent_timeline_num();
+                }
+            }
+        });
+        ShowRow("TimeLine::GetMoments", num_branches, baseline, result);
+    }
+}
@@ -1,7 +1,9 @@
 #include "catch/include/catch.hpp"
 
+#include <cstdint>
 #include <sstream>
 #include <iostream>
+#include <thread>
 #include <unordered_set>
 #include <utility>
 #include <boost/archive/text_oarchive.hpp>
@@ -12,6 +14,7 @@
 #include "../src/roundinfoview.hpp"
 #include "../src/itemsutil.hpp"
 #include "../src/aliases.hpp"
+#include "../src/momentfeed.hpp"
 #include "../src/momentoverview.hpp"
 #include "../src/movedata.hpp"
 
@@ -20,6 +23,19 @@ using namespace roundinfo;
 using namespace item;
 using namespace external;
 
+// The layout MomentOverview was serialized with before structured tags
+struct LegacyMomentOverview {
+    Moment moment;
+    Effect effect;
+    MomentOverview::TaggedValuesArr item_state_data;
+    RoundInfoView round_info;
+
+    template<typename Archive>
+    void serialize(Archive& ar, unsigned int const) {
+        ar & moment & effect & item_state_data & round_info;
+    }
+};
+
 extern RoundInfo MakeRoundInfo();
 
 TEST_CASE("MomentOverview overall", "[momentoverview, external_all]") {
@@ -34,11 +50,11 @@ TEST_CASE("MomentOverview overall", "[momentoverview, external_all]") {
     Effect e = antitelephone->View(m) + bridge->View(m) +
                oracle->View(m) + shield->View(m);
 
-    MomentOverview::TaggedValuesArr states {
-        antitelephone->StateTaggedValues(m),
-        bridge->StateTaggedValues(m),
-        oracle->StateTaggedValues(m),
-        shield->StateTaggedValues(m)};
+    MomentOverview::StateTagsArr states {
+        antitelephone->State(m),
+        bridge->State(m),
+        oracle->State(m),
+        shield->State(m)};
 
     MomentOverview overview{};
 
@@ -61,6 +77,8 @@ TEST_CASE("MomentOverview overall", "[momentoverview, external_all]") {
                 oracle->StateTaggedValues(m));
         REQUIRE(overview.ItemState(ItemTypeID(ItemType::kShield)) ==
                 shield->StateTaggedValues(m));
+        REQUIRE(overview.ItemStateTags(ItemTypeID(ItemType::kBridge)) ==
+                bridge->State(m));
         RoundInfoView const& viewer2 = overview.round_info();
         REQUIRE(viewer.active() == viewer2.active());
         REQUIRE(viewer.player() == viewer2.player());
@@ -86,6 +104,94 @@ TEST_CASE("MomentOverview overall", "[momentoverview, external_all]") {
         input_archive >> overview;
         continuation();
     }
+
+    SECTION("Deserialization of tagged strings") {
+        std::stringstream stream{};
+        {
+            boost::archive::text_oarchive output_archive{stream};
+            output_archive << LegacyMomentOverview{
+                m, e, {antitelephone->StateTaggedValues(m),
+                       bridge->StateTaggedValues(m),
+                       oracle->StateTaggedValues(m),
+                       shield->StateTaggedValues(m)}, viewer};
+        }
+        boost::archive::text_iarchive input_archive{stream};
+        input_archive >> overview;
+        continuation();
+    }
+}
+
+TEST_CASE("MomentFeed overall", "[momentfeed, external_all]") {
+    RoundInfo info{MakeRoundInfo()};
+    MomentFeed feed{4};
+    MomentFeed::Reader early = feed.Subscribe();
+    MomentEvent event{};
+    REQUIRE_FALSE(early.TryNext(event));
+
+    feed.Publish(MomentEvent::FromRoundInfo(Moment{0, 0}, true, info));
+    MomentFeed::Reader late = feed.Subscribe();
+    REQUIRE(early.TryNext(event));
+    REQUIRE(event.moment == Moment{0, 0});
+    REQUIRE(event.new_timeline);
+    REQUIRE(event.num_players == 5);
+    REQUIRE(event.location[1] == 4);
+    REQUIRE(event.location[3] == RoundInfo::kGraveyardLocation);
+    REQUIRE(event.health_remaining[2] == 26);
+    REQUIRE(event.damage_received[1] == 2);
+    REQUIRE(event.active == 0x7);
+    for (int player = 0; player < 5; player++) {
+        REQUIRE(((event.allies[player] >> player) & 1) == 1);
+        for (int other = 0; other < 5; other++) {
+            REQUIRE(((event.allies[player] >> other) & 1) ==
+                    info.alliance_data().Value(player, other));
+        }
+    }
+    REQUIRE_FALSE(early.TryNext(event));
+
+    // Slow readers skip the records that were overwritten
+    for (int time = 1; time <= 6; time++) {
+        feed.Publish(MomentEvent::FromRoundInfo(Moment{0, time}, false, info));
+    }
+    REQUIRE(feed.num_published() == 7);
+    for (int time = 3; time <= 6; time++) {
+        REQUIRE(late.TryNext(event));
+        REQUIRE(event.moment == Moment{0, time});
+        REQUIRE_FALSE(event.new_timeline);
+    }
+    REQUIRE_FALSE(late.TryNext(event));
+    REQUIRE(late.num_missed() == 2);
+
+    SECTION("Concurrent reading") {
+        int constexpr kNumEvents = 100000;
+        MomentFeed::Reader reader = feed.Subscribe();
+        std::thread writer{[&feed, &info] () {
+            MomentEvent event = MomentEvent::FromRoundInfo(
+                Moment{0, 0}, false, info);
+            for (int time = 7; time < 7 + kNumEvents; time++) {
+                event.moment = Moment{0, time};
+                event.location.fill(time);
+                feed.Publish(event);
+            }
+        }};
+        int last_time = 6;
+        int num_bad = 0;
+        std::uint64_t num_read = 0;
+        while (last_time < 6 + kNumEvents) {
+            if (!reader.TryNext(event)) {
+                continue;
+            }
+            num_read++;
+            int time = event.moment.time();
+            if (time <= last_time || event.location[0] != time ||
+                    event.location[5] != time) {
+                num_bad++;
+            }
+            last_time = time;
+        }
+        writer.join();
+        REQUIRE(num_bad == 0);
+        REQUIRE(num_read + reader.num_missed() == kNumEvents);
+    }
 }
 
 TEST_CASE("MoveData overall", "[movedata, external_all]") {
@@ -3,6 +3,7 @@
 #include <sstream>
 #include <iostream>
 #include <utility>
+#include <unordered_map>
 #include <unordered_set>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
@@ -14,11 +15,55 @@
 #include "../src/roundinfo.hpp"
 #include "../src/roundinfoview.hpp"
 #include "../src/itemsutil.hpp"
+#include "../src/itemset.hpp"
+#include "../src/itemstatetable.hpp"
+#include "../src/propertiespool.hpp"
+#include "../src/retirementlog.hpp"
+#include "../src/spillfile.hpp"
 
 using namespace item;
 using namespace timeplane;
 using namespace roundinfo;
 
+// The layout ItemProperties was serialized with before custom slots
+struct LegacyItemProperties {
+    int lockdown;
+    int cooldown;
+    std::unordered_map<int, int> custom;
+
+    template<typename Archive>
+    void serialize(Archive& ar, unsigned int const) {
+        ar & lockdown & cooldown & custom;
+    }
+};
+
+// Exposes the standard update of item properties
+struct StepUpdater: Item {
+    using Item::StandardStepUpdate;
+};
+
+// The standard update as computed before the transition table
+bool ReferenceStepUpdate(ItemProperties& properties, int energy_input) {
+    int lockdown = properties.lockdown();
+    if (lockdown <= energy_input) {
+        properties.set_lockdown(0);
+        energy_input -= lockdown;
+        int cooldown = properties.cooldown();
+        if (cooldown < energy_input - 1) {
+            properties.set_cooldown(0);
+            return true;
+        }
+        int new_cooldown = cooldown - energy_input + 1;
+        if (new_cooldown > Item::kMaxCooldown) {
+            new_cooldown = Item::kMaxCooldown;
+        }
+        properties.set_cooldown(new_cooldown);
+        return false;
+    }
+    properties.set_lockdown(lockdown - energy_input);
+    return false;
+}
+
 TEST_CASE("ItemProperties overall", "[itemproperties, item_all]") {
     ItemProperties ip;
     ip.set_lockdown(10);
@@ -46,6 +91,445 @@ TEST_CASE("ItemProperties overall", "[itemproperties, item_all]") {
     REQUIRE(copy.custom(prop1_id) == 7);
     REQUIRE(move.custom(prop0_id) == 8);
     REQUIRE(move.custom(prop1_id) == 7);
+
+    ItemProperties unset{};
+    REQUIRE_THROWS_AS(unset.custom(prop0_id), std::out_of_range);
+    REQUIRE_THROWS_AS(unset.set_custom(ItemProperties::kNumCustomSlots, 0),
+                      std::out_of_range);
+
+    SECTION("Serialization and deserialization") {
+        std::stringstream stream{};
+        {
+            boost::archive::text_oarchive output_archive{stream};
+            output_archive << copy;
+        }
+        ItemProperties loaded{};
+        boost::archive::text_iarchive input_archive{stream};
+        input_archive >> loaded;
+        REQUIRE(loaded.lockdown() == 10);
+        REQUIRE(loaded.cooldown() == 9);
+        REQUIRE(loaded.custom(prop0_id) == 8);
+        REQUIRE(loaded.custom(prop1_id) == 7);
+    }
+
+    SECTION("Loading the version 0 format") {
+        std::stringstream stream{};
+        {
+            boost::archive::text_oarchive output_archive{stream};
+            output_archive << LegacyItemProperties{10, 9, {{prop1_id, 7}}};
+        }
+        ItemProperties loaded{};
+        boost::archive::text_iarchive input_archive{stream};
+        input_archive >> loaded;
+        REQUIRE(loaded.lockdown() == 10);
+        REQUIRE(loaded.cooldown() == 9);
+        REQUIRE(loaded.custom(prop1_id) == 7);
+        REQUIRE_THROWS_AS(loaded.custom(prop0_id), std::out_of_range);
+    }
+}
+
+TEST_CASE("StateTags overall", "[statetags, item_all]") {
+    StateTags tags{};
+    REQUIRE(tags.size() == 0);
+    REQUIRE(FormatStateTags(tags).empty());
+    tags.Add(StateTag::kBridgeActivated, true);
+    tags.Add(StateTag::kBridgeChargeRemaining, 3);
+    tags.Add(StateTag::kBridgeStartupTime, -1);
+    REQUIRE(tags.size() == StateTags::kCapacity);
+    REQUIRE(tags.begin()->tag == StateTag::kBridgeActivated);
+    REQUIRE(tags.end() - tags.begin() == 3);
+
+    TaggedValues expected{{"bridge_activated", "Active"},
+                          {"bridge_charge_remaining", "3"},
+                          {"bridge_startup_time", "-1"}};
+    REQUIRE(FormatStateTags(tags) == expected);
+    REQUIRE(ParseStateTags(expected) == tags);
+    REQUIRE(FormatStateTag(StateTagValue{StateTag::kOracleActivated, 1}) ==
+            TaggedValue{"oracle_activated", "Inactive"});
+    REQUIRE(ParseStateTags({{"oracle_activated", "Active"}}).begin()->value ==
+            0);
+    for (int id = 0; id < StateTagCount; id++) {
+        StateTags single{};
+        single.Add(static_cast<StateTag>(id), 1);
+        REQUIRE(ParseStateTags(FormatStateTags(single)) == single);
+    }
+
+    StateTags other{};
+    other.Add(StateTag::kBridgeActivated, false);
+    REQUIRE(!(other == tags));
+    REQUIRE_THROWS_AS(ParseStateTags({{"bridge_activated", "On"}}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseStateTags({{"unknown", "1"}}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(ParseStateTags({{"shield_regular", "1x"}}),
+                      std::invalid_argument);
+}
+
+TEST_CASE("ItemStateTable overall", "[itemstatetable, item_all]") {
+    ItemStateTable table{2 * ItemTypeCount};
+    Moment m0{0, 0};
+    ItemArr items0 = MakeItemPtrs(m0, &table, 0);
+    ItemArr items1 = MakeItemPtrs(m0, &table, 1);
+    REQUIRE(table.usage().num_entries == 1);
+
+    // Every item of both players shares the row of the moment
+    ItemStateTable::Row row = table.at(m0);
+    REQUIRE(row.size() == 2 * ItemTypeCount);
+    for (int i = 0; i < ItemTypeCount; i++) {
+        REQUIRE(&items0[i]->GetProperties(m0) == &table.at(m0, i));
+        REQUIRE(items0[i]->GetProperties(m0) == row[i]);
+        REQUIRE(items1[i]->GetProperties(m0) == row[ItemTypeCount + i]);
+    }
+    REQUIRE(table.count(Moment{0, 1}) == 0);
+    REQUIRE_THROWS_AS(table.at(Moment{0, 1}), std::out_of_range);
+
+    // Confirming any item of a new moment creates its row
+    Moment m1{0, 1};
+    int const bridge = ItemTypeID(ItemType::kBridge);
+    items1[bridge]->Duplicate(m0);
+    items1[bridge]->ConfirmPending(m1);
+    REQUIRE(table.usage().num_entries == 2);
+    REQUIRE(table.at(m1, ItemTypeCount + bridge).lockdown() ==
+            Bridge::kUnlockRequirement);
+    // Columns not set yet keep their properties from the previous moment
+    REQUIRE(table.at(m1, bridge).lockdown() == Bridge::kUnlockRequirement);
+
+    // Rows of retired moments are erased together
+    RetirementLog log{};
+    log.Retire(0, 1, 2);
+    REQUIRE(table.Reclaim(log, 0) == 1);
+    REQUIRE(items0[bridge]->Reclaim(log, 0) == 0);
+    REQUIRE(table.count(m1) == 0);
+    REQUIRE(items0[bridge]->properties_usage().num_entries == 1);
+
+    SpillFile file{};
+    REQUIRE(table.Spill(file, 1) == 1);
+    REQUIRE(items1[bridge]->GetProperties(m0).lockdown() ==
+            Bridge::kUnlockRequirement);
+    REQUIRE_THROWS_AS(table.Set(m0, 0, ItemProperties{}), std::logic_error);
+}
+
+extern RoundInfo MakeRoundInfo();
+
+TEST_CASE("PropertiesPool overall", "[propertiespool, item_all]") {
+    PropertiesPool pool{};
+    REQUIRE(pool.size() == 0);
+    ItemProperties first{};
+    first.set_lockdown(45);
+    first.set_cooldown(Item::kMaxCooldown);
+    ItemProperties second = first;
+    second.set_custom(0, -1);
+    ItemProperties third = second;
+    third.set_custom(0, 0);
+
+    PropertiesPool::Handle h1 = pool.Intern(first);
+    PropertiesPool::Handle h2 = pool.Intern(second);
+    PropertiesPool::Handle h3 = pool.Intern(third);
+    REQUIRE(h1 != h2);
+    REQUIRE(h2 != h3);
+    REQUIRE(pool.size() == 3);
+    REQUIRE(std::hash<ItemProperties>{}(first) ==
+            std::hash<ItemProperties>{}(ItemProperties{first}));
+
+    // Equal properties share the canonical copy
+    ItemProperties const& canonical = pool.at(h2);
+    ItemProperties copy = first;
+    copy.set_custom(0, -1);
+    REQUIRE(pool.Intern(copy) == h2);
+    REQUIRE(pool.size() == 3);
+    for (int i = 0; i < 100; i++) {
+        ItemProperties other = first;
+        other.set_cooldown(i);
+        pool.Intern(other);
+    }
+    REQUIRE(&pool.at(h2) == &canonical);
+    REQUIRE(pool.at(h3).custom(0) == 0);
+    REQUIRE(pool.at(h1) == first);
+    REQUIRE(!pool.at(h1).has_custom(0));
+    REQUIRE(!pool.at(h1).has_custom(ItemProperties::kNumCustomSlots));
+    REQUIRE(pool.memory_bytes() >= pool.size() * sizeof(ItemProperties));
+}
+
+TEST_CASE("ItemStateTable deltas", "[itemstatetable, item_all]") {
+    int const num_columns = 3;
+    ItemStateTable table{num_columns};
+    ItemProperties locked{};
+    locked.set_lockdown(45);
+    locked.set_cooldown(Item::kMaxCooldown);
+    ItemProperties active = locked;
+    active.set_lockdown(0);
+    active.set_custom(0, 7);
+    REQUIRE(active != locked);
+    ItemProperties copy = active;
+    REQUIRE(copy == active);
+    copy.set_custom(1, 0);
+    REQUIRE(copy != active);
+
+    // Column 1 changes every moment while the others stay locked
+    int const num_moments = 3 * ItemStateTable::kKeyframeInterval + 5;
+    std::vector<ItemStateTable::Row> expected;
+    for (int t = 0; t < num_moments; t++) {
+        ItemStateTable::Row row(num_columns, locked);
+        row[1] = active;
+        row[1].set_cooldown(t % 3);
+        if (t >= 20) {
+            row[2] = active;
+        }
+        for (int column = 0; column < num_columns; column++) {
+            table.Set(Moment{0, t}, column, row[column]);
+        }
+        expected.push_back(row);
+    }
+
+    // Storing the changes uses less memory than changing every column
+    std::size_t bytes = table.usage().bytes;
+    ItemStateTable busy{num_columns};
+    for (int t = 0; t < num_moments; t++) {
+        for (int column = 0; column < num_columns; column++) {
+            ItemProperties properties = locked;
+            properties.set_cooldown(t);
+            busy.Set(Moment{0, t}, column, properties);
+        }
+    }
+    REQUIRE(bytes < busy.usage().bytes);
+    for (int t = 0; t < num_moments; t++) {
+        REQUIRE(table.at(Moment{0, t}) == expected[t]);
+        for (int column = 0; column < num_columns; column++) {
+            REQUIRE(table.at(Moment{0, t}, column) == expected[t][column]);
+        }
+    }
+    REQUIRE(table.usage().bytes == bytes);
+    REQUIRE(table.usage().num_entries == num_moments);
+
+    // Every moment refers to the few distinct properties in the pool
+    REQUIRE(table.pool().size() == 6);
+    REQUIRE(&table.at(Moment{0, 3}, 0) == &table.at(Moment{0, 40}, 0));
+
+    // Setting a column back to its previous value drops the change
+    Moment last{0, num_moments - 1};
+    table.Set(last, 1, expected[num_moments - 2][1]);
+    REQUIRE(table.at(last, 1) == expected[num_moments - 2][1]);
+    REQUIRE(table.at(last, 0) == locked);
+    REQUIRE_THROWS_AS(table.Set(Moment{0, 3}, 1, locked), std::logic_error);
+
+    // A new timeline starts with a full row of its own
+    Moment branched{1, 10};
+    table.Set(branched, 0, active);
+    REQUIRE(table.at(branched, 0) == active);
+    REQUIRE(table.at(branched, 1) == ItemProperties{});
+    table.Set(Moment{1, 11}, 2, locked);
+    REQUIRE(table.at(Moment{1, 11}, 0) == active);
+    REQUIRE(table.at(Moment{1, 11}, 2) == locked);
+
+    // Retiring the latest moments keeps every earlier row readable
+    RetirementLog log{};
+    log.Retire(0, 30, num_moments);
+    REQUIRE(table.Reclaim(log, 0) == num_moments - 30);
+    for (int t = 0; t < 30; t++) {
+        REQUIRE(table.at(Moment{0, t}) == expected[t]);
+    }
+    table.Set(Moment{0, 30}, 0, active);
+    REQUIRE(table.at(Moment{0, 30}, 0) == active);
+    REQUIRE(table.at(Moment{0, 30}, 2) == expected[29][2]);
+
+    // The rows from the full row at time 16 onward stay in RAM, since the
+    // row at time 25 depends on them, while the branch has no row at 25
+    SpillFile file{};
+    REQUIRE(table.Spill(file, 25) == 18);
+    REQUIRE(table.usage().num_spilled == 18);
+    std::size_t spilled_bytes = table.usage().bytes;
+    for (int t = 25; t <= 30; t++) {
+        table.at(Moment{0, t});
+    }
+    // Nothing had to be read back from the file
+    REQUIRE(table.usage().bytes == spilled_bytes);
+    for (int t = 0; t < 30; t++) {
+        REQUIRE(table.at(Moment{0, t}) == expected[t]);
+    }
+    REQUIRE(table.at(Moment{0, 30}, 1) == expected[29][1]);
+    REQUIRE(table.at(Moment{1, 11}, 0) == active);
+    REQUIRE(table.Spill(file, 25) == 0);
+}
+
+TEST_CASE("ItemStateTable staging", "[itemstatetable, item_all]") {
+    int const num_columns = 4;
+    ItemStateTable table{num_columns};
+    ItemProperties locked{};
+    locked.set_lockdown(45);
+    ItemProperties active{};
+    active.set_custom(0, 3);
+    for (int column = 0; column < num_columns; column++) {
+        table.Set(Moment{0, 0}, column, locked);
+    }
+
+    // Nothing is visible until the staged columns are committed
+    table.Stage(1, active);
+    table.Stage(3, locked);
+    table.Stage(3, active);
+    REQUIRE(table.num_staged() == 2);
+    REQUIRE(table.IsStaged(1));
+    REQUIRE(!table.IsStaged(2));
+    REQUIRE(table.count(Moment{0, 1}) == 0);
+    table.Commit(Moment{0, 1});
+    REQUIRE(table.num_staged() == 0);
+    REQUIRE(!table.IsStaged(1));
+    REQUIRE(table.at(Moment{0, 1}) ==
+            (ItemStateTable::Row{locked, active, locked, active}));
+
+    // Discarding leaves the table as it was
+    table.Stage(0, active);
+    table.Discard();
+    REQUIRE(table.num_staged() == 0);
+    table.Commit(Moment{0, 2});
+    REQUIRE(table.at(Moment{0, 2}) == table.at(Moment{0, 1}));
+
+    // Committing one column leaves the others staged
+    table.Stage(0, active);
+    table.Stage(2, active);
+    table.Commit(Moment{0, 3}, 2);
+    REQUIRE(table.num_staged() == 1);
+    REQUIRE(table.at(Moment{0, 3}, 0) == locked);
+    REQUIRE(table.at(Moment{0, 3}, 2) == active);
+
+    // A failed commit changes nothing and keeps the columns staged
+    REQUIRE_THROWS_AS(table.Commit(Moment{0, 1}), std::logic_error);
+    REQUIRE(table.num_staged() == 1);
+    REQUIRE(table.at(Moment{0, 1}, 0) == locked);
+    table.Commit(Moment{0, 4});
+    REQUIRE(table.at(Moment{0, 4}, 0) == active);
+
+    // Items stage their properties in the table until confirmed
+    ItemSet items{Moment{0, 0}};
+    items[0].Duplicate(Moment{0, 0});
+    items[0].ConfirmPending(Moment{0, 1});
+    REQUIRE_THROWS_AS(items[0].ConfirmPending(Moment{0, 2}),
+                      std::runtime_error);
+}
+
+// Requires that an item set behaves exactly as the separate items
+void RequireSameItems(ItemSet const& set, ItemArr const& arr, Moment m,
+                      Effect const& set_effect, Effect const& arr_effect) {
+    REQUIRE(set_effect.attack_increase() == arr_effect.attack_increase());
+    REQUIRE(set_effect.max_hitpoint_increase() ==
+            arr_effect.max_hitpoint_increase());
+    REQUIRE(set_effect.shield_amount() == arr_effect.shield_amount());
+    REQUIRE(set_effect.antitelephone_departure() ==
+            arr_effect.antitelephone_departure());
+    REQUIRE(set_effect.antitelephone_dest_allowed() ==
+            arr_effect.antitelephone_dest_allowed());
+    REQUIRE(set_effect.player_make_active() ==
+            arr_effect.player_make_active());
+    ItemSet::StateTagsArr tags = set.State(m);
+    int earliest = Item::kNoDestination;
+    for (int i = 0; i < ItemTypeCount; i++) {
+        ItemProperties const& set_properties = set[i].GetProperties(m);
+        ItemProperties const& arr_properties = arr[i]->GetProperties(m);
+        REQUIRE(set_properties.lockdown() == arr_properties.lockdown());
+        REQUIRE(set_properties.cooldown() == arr_properties.cooldown());
+        if (i != ItemTypeID(ItemType::kAntitelephone)) {
+            REQUIRE(set_properties.custom(0) == arr_properties.custom(0));
+        }
+        REQUIRE(tags[i] == arr[i]->State(m));
+        REQUIRE(FormatStateTags(tags[i]) == arr[i]->StateTaggedValues(m));
+        earliest = std::min(earliest, arr[i]->EarliestDestination(m));
+    }
+    REQUIRE(set.EarliestDestination(m) == earliest);
+}
+
+TEST_CASE("ItemSet overall", "[itemset, item_all]") {
+    TimePlane tp{};
+    TimeLine* tl = &tp.rightmost_timeline();
+    Moment m = tl->LatestMoment();
+    ItemSet set{m};
+    ItemArr arr = MakeItemPtrs(m);
+    RoundInfo info{MakeRoundInfo()};
+    RoundInfoView viewer{info, 0};
+
+    Effect arr_effect{};
+    for (ItemPtr const& item: arr) {
+        arr_effect += item->View(m);
+    }
+    RequireSameItems(set, arr, m, set.View(m), arr_effect);
+    REQUIRE(&set[ItemTypeID(ItemType::kOracle)] ==
+            &static_cast<ItemSet const&>(set)[ItemTypeID(ItemType::kOracle)]);
+
+    // Unlock every item over a few rounds, then keep them busy
+    std::vector<ItemSet::EnergyInputs> rounds{
+        {{0, 20, 20, 20}}, {{0, 25, 25, 25}}, {{1, 3, 2, 4}},
+        {{0, 5, 0, 1}}, {{2, 0, 5, 0}}, {{0, 1, 1, 1}}};
+    for (ItemSet::EnergyInputs const& energy_inputs: rounds) {
+        Moment mn = tl->MakeMoment();
+        Effect set_effect = set.Step(m, viewer, energy_inputs);
+        arr_effect = Effect{};
+        for (int i = 0; i < ItemTypeCount; i++) {
+            arr_effect += arr[i]->Step(m, viewer, energy_inputs[i]);
+        }
+        set.ConfirmPending(mn);
+        for (ItemPtr const& item: arr) {
+            item->ConfirmPending(mn);
+        }
+        m = mn;
+        RequireSameItems(set, arr, m, set_effect, arr_effect);
+    }
+
+    // A dead player puts no energy into any item
+    info.HealthRemainingIterator()[0] = 0;
+    RoundInfoView dead_viewer{info, 0};
+    Effect set_effect = set.Step(m, dead_viewer, {{3, 3, 3, 3}});
+    arr_effect = Effect{};
+    for (ItemPtr const& item: arr) {
+        arr_effect += item->Step(m, dead_viewer, 3);
+    }
+    Moment mn = tl->MakeMoment();
+    set.ConfirmPending(mn);
+    for (ItemPtr const& item: arr) {
+        item->ConfirmPending(mn);
+    }
+    RequireSameItems(set, arr, mn, set_effect, arr_effect);
+
+    // Branch back to an earlier moment
+    Moment dest = tl->GetMoment(2);
+    REQUIRE_THROWS_AS(set.Branch(dest, mn), std::invalid_argument);
+    set_effect = set.Branch(mn, dest);
+    arr_effect = Effect{};
+    for (ItemPtr const& item: arr) {
+        arr_effect += item->Branch(mn, dest);
+    }
+    tl = &tp.MakeNewTimeLine(dest.time());
+    Moment branched = tl->LatestMoment();
+    set.ConfirmPending(branched);
+    for (ItemPtr const& item: arr) {
+        item->ConfirmPending(branched);
+    }
+    RequireSameItems(set, arr, branched, set_effect, arr_effect);
+
+    // Duplicating from a moment or from captured handles
+    int constexpr kShield = ItemTypeID(ItemType::kShield);
+    ItemStateTable table{2 * ItemTypeCount};
+    ItemSet shared{Moment{0, 0}, &table, 1};
+    ItemStateTable::Handles first = table.HandlesAt(Moment{0, 0});
+    REQUIRE(table.pool().at(first[ItemTypeCount + kShield]) ==
+            shared[kShield].GetProperties(Moment{0, 0}));
+    Moment m1{0, 1};
+    ItemProperties unlocked = shared[kShield].GetProperties(Moment{0, 0});
+    unlocked.set_lockdown(0);
+    table.Stage(ItemTypeCount + kShield, unlocked);
+    table.Commit(m1);
+    REQUIRE(shared[kShield].GetProperties(m1).lockdown() == 0);
+    Moment m2{0, 2};
+    shared.Duplicate(first, ItemTypeCount);
+    shared.ConfirmPending(m2);
+    REQUIRE(shared[kShield].GetProperties(m2) ==
+            shared[kShield].GetProperties(Moment{0, 0}));
+    REQUIRE(shared[0].GetProperties(m2) == table.at(m2, ItemTypeCount));
+    Moment m3{0, 3};
+    shared.Duplicate(table.HandlesAt(m1), ItemTypeCount);
+    shared.ConfirmPending(m3);
+    REQUIRE(shared[kShield].GetProperties(m3).lockdown() == 0);
+    Moment m4{0, 4};
+    shared.Duplicate(m3);
+    shared.ConfirmPending(m4);
+    REQUIRE(shared[kShield].GetProperties(m4).lockdown() == 0);
 }
 
 TEST_CASE("Effect overall", "[effect, item_all]") {
@@ -124,7 +608,30 @@ TEST_CASE("Effect overall", "[effect, item_all]") {
     REQUIRE(temp.player_make_active());
 }
 
-extern RoundInfo MakeRoundInfo();
+TEST_CASE("Item standard step update", "[item, item_all]") {
+    // Energy past this always activates an unlocked item, so the table
+    // clamps larger inputs to its last column
+    int constexpr kMaxUsefulEnergy = Item::kMaxCooldown + 2;
+    // Cooldowns outside 0 to kMaxCooldown take the path without the table
+    for (int cooldown = -2; cooldown <= Item::kMaxCooldown + 3; cooldown++) {
+        for (int lockdown = 0; lockdown <= 12; lockdown++) {
+            for (int energy = 0; energy <= lockdown + kMaxUsefulEnergy + 4;
+                    energy++) {
+                ItemProperties expected{};
+                expected.set_lockdown(lockdown);
+                expected.set_cooldown(cooldown);
+                ItemProperties actual{expected};
+                bool expected_activated =
+                    ReferenceStepUpdate(expected, energy);
+                bool actual_activated =
+                    StepUpdater::StandardStepUpdate(actual, energy);
+                REQUIRE(actual_activated == expected_activated);
+                REQUIRE(actual.lockdown() == expected.lockdown());
+                REQUIRE(actual.cooldown() == expected.cooldown());
+            }
+        }
+    }
+}
 
 void PrintTags(ItemPtr const& ptr, Moment m) {
     for (TaggedValue const& thing : ptr->StateTaggedValues(m)) {
@@ -142,6 +649,7 @@ TEST_CASE("Antitelephone item tests", "[antitelephone, item_all]") {
     RoundInfo info{MakeRoundInfo()};
     RoundInfoView viewer{info, 0};
 
+    REQUIRE(antitelephone->EarliestDestination(m) == Item::kNoDestination);
     Effect e = antitelephone->View(m);
     REQUIRE(e.attack_increase() == Item::kBasicAttack);
     REQUIRE(e.max_hitpoint_increase() == Item::kBasicMaxHitpoints);
@@ -333,6 +841,7 @@ TEST_CASE("Bridge item tests", "[bridge, item_all]") {
     REQUIRE(!e.antitelephone_departure());
     REQUIRE(!e.antitelephone_dest_allowed());
     REQUIRE(!e.player_make_active());
+    REQUIRE(bridge->EarliestDestination(m) == 1);
 
     // Time 0
     // Take big steps towards unlocking it
@@ -416,6 +925,9 @@ TEST_CASE("Bridge item tests", "[bridge, item_all]") {
     // Now the bridge is activated
     REQUIRE(!e.antitelephone_dest_allowed());
 
+    // Once active, nothing before the startup time can be reached
+    REQUIRE(bridge->EarliestDestination(mn) == 5);
+
     // Charge remaining 4, activated since 5, time 5
     m = mn;
     mn = tl->MakeMoment();
@@ -598,6 +1110,8 @@ TEST_CASE("Oracle item tests", "[oracle, item_all]") {
     oracle->ConfirmPending(mn);
     // Now the oracle is activated
     REQUIRE(e.player_make_active()); // !!!
+    REQUIRE(oracle->State(mn).begin()[1].value == 1);
+    REQUIRE(oracle->StateTaggedValues(mn)[1].second == "Inactive");
 
     // Activation energy 5, time 5
     m = mn;
@@ -8,6 +8,9 @@
 #include <boost/dynamic_bitset.hpp>
 
 #include "../src/aliases.hpp"
+#include "../src/divergenceindex.hpp"
+#include "../src/playerhistory.hpp"
+#include "../src/retirementlog.hpp"
 #include "../src/symmetricbitmatrix.hpp"
 #include "../src/roundinfo.hpp"
 #include "../src/roundinfoview.hpp"
@@ -104,6 +107,90 @@ RoundInfo MakeRoundInfo() {
     return info;
 }
 
+TEST_CASE("DivergenceIndex overall", "[divergenceindex, round_all]") {
+    DivergenceIndex index{3};
+    REQUIRE(index.diverged() == 0);
+    REQUIRE(index.first_divergence(0) == DivergenceIndex::kNotDiverged);
+    REQUIRE_THROWS_AS(index.first_divergence(3), std::out_of_range);
+
+    // Players 0 and 1 meet in both timelines
+    REQUIRE(index.Update(4, {0x2, 0x1, 0x0}, {0x2, 0x1, 0x0}) == 0);
+    REQUIRE(index.diverged() == 0);
+
+    // Player 2 joins them in the rightmost timeline only
+    REQUIRE(index.Update(5, {0x2, 0x1, 0x0}, {0x6, 0x5, 0x3}) == 0x7);
+    REQUIRE(index.Update(6, {0x0, 0x4, 0x2}, {0x0, 0x4, 0x2}) == 0);
+    REQUIRE(index.diverged() == 0x7);
+    REQUIRE(index.first_divergence(0) == 5);
+    REQUIRE(index.first_divergence(1) == 5);
+    REQUIRE(index.first_divergence(2) == 5);
+
+    // Players 1 and 2 no longer meet in the rightmost timeline
+    index.Reset();
+    REQUIRE(index.diverged() == 0);
+    REQUIRE(index.Update(2, {0x0, 0x4, 0x2}, {0x0, 0x0, 0x0}) == 0x6);
+    REQUIRE(index.first_divergence(0) == DivergenceIndex::kNotDiverged);
+    REQUIRE(index.first_divergence(1) == 2);
+}
+
+TEST_CASE("PlayerHistory overall", "[playerhistory, round_all]") {
+    using timeplane::RetirementLog;
+    using timeplane::TimeLine;
+    PlayerHistory history{5};
+    REQUIRE(history.size() == 0);
+    REQUIRE_THROWS_AS(history.Location(Moment{0, 0}, 0), std::out_of_range);
+
+    // Player 0 moves one location further every round
+    RoundInfo info = MakeRoundInfo();
+    for (int time = 0; time < 6; time++) {
+        info.LocationIterator()[0] = time;
+        history.Record(Moment{0, time}, info);
+    }
+    info.LocationIterator()[0] = 10;
+    history.Record(Moment{1, 3}, info);
+    REQUIRE(history.size() == 7);
+    REQUIRE_THROWS_AS(history.Record(Moment{0, 7}, info),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(history.Record(Moment{1, 3}, info),
+                      std::invalid_argument);
+
+    REQUIRE(history.Location(Moment{0, 4}, 0) == 4);
+    REQUIRE(history.Location(Moment{0, 4}, 1) == 4);
+    REQUIRE(history.Location(Moment{1, 3}, 0) == 10);
+    REQUIRE(history.Location(Moment{1, 3}, 3) ==
+            RoundInfo::kGraveyardLocation);
+    REQUIRE(history.HealthRemaining(Moment{0, 2}, 2) == 26);
+    REQUIRE(history.DamageReceived(Moment{1, 3}, 1) == 2);
+    REQUIRE_THROWS_AS(history.Location(Moment{0, 6}, 0), std::out_of_range);
+    REQUIRE_THROWS_AS(history.Location(Moment{1, 2}, 0), std::out_of_range);
+    REQUIRE_THROWS_AS(history.Location(Moment{0, 0}, 5), std::out_of_range);
+
+    // Ranges stream through the values of one timeline
+    auto locations = history.Locations(TimeLine::Span{0, 1, 5}, 0);
+    REQUIRE(locations.size() == 4);
+    int expected = 1;
+    for (int location: locations) {
+        REQUIRE(location == expected);
+        expected++;
+    }
+    REQUIRE(history.HealthRemainings(TimeLine::Span{1, 3, 4}, 4).size() == 1);
+    REQUIRE(history.DamageReceiveds(TimeLine::Span{0, 2, 2}, 2).size() == 0);
+    REQUIRE_THROWS_AS(history.Locations(TimeLine::Span{0, 4, 7}, 0),
+                      std::out_of_range);
+
+    // Retired moments are dropped
+    RetirementLog log{};
+    log.Retire(0, 4, 6);
+    log.Retire(1, 3, 4);
+    REQUIRE(history.Reclaim(log, 0) == 3);
+    REQUIRE(history.size() == 4);
+    REQUIRE(history.Reclaim(log, 2) == 0);
+    REQUIRE(history.Location(Moment{0, 3}, 0) == 3);
+    REQUIRE_THROWS_AS(history.Location(Moment{0, 4}, 0), std::out_of_range);
+    REQUIRE_THROWS_AS(history.Location(Moment{1, 3}, 0), std::out_of_range);
+    REQUIRE(history.memory_bytes() > 0);
+}
+
 TEST_CASE("RoundInfo overall", "[roundinfo, round_all]") {
     RoundInfo info = MakeRoundInfo();
 
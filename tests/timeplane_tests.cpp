@@ -1,14 +1,26 @@
 #include <catch/include/catch.hpp>
 
+#include <cstddef>
+#include <memory>
 #include <sstream>
 #include <iostream>
 #include <utility>
 #include <unordered_set>
+#include <vector>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/optional/optional.hpp>
+#include <boost/serialization/string.hpp>
 
+#include "../src/arrivalindex.hpp"
+#include "../src/blockarena.hpp"
 #include "../src/moment.hpp"
+#include "../src/momentstore.hpp"
+#include "../src/momentmap.hpp"
+#include "../src/retirementlog.hpp"
+#include "../src/sharedmomentmap.hpp"
+#include "../src/spillfile.hpp"
+#include "../src/tieredmomentmap.hpp"
 #include "../src/timeline.hpp"
 #include "../src/timeplane.hpp"
 
@@ -58,6 +70,355 @@ TEST_CASE("Moment hash and equality", "[moment, timeplane_all]") {
     REQUIRE(hasher(m1) == hasher(m3));
 }
 
+TEST_CASE("Moment key packing", "[moment, timeplane_all]") {
+    Moment m1{2, 12};
+    Moment m2{12, 2};
+    Moment m3{0, 0};
+    Moment m4{70000, 123456};
+
+    REQUIRE(m1.key() != m2.key());
+    REQUIRE(m1.key() < Moment(2, 13).key());
+    REQUIRE(m1.key() < Moment(3, 0).key());
+    REQUIRE(Moment::FromKey(m1.key()) == m1);
+    REQUIRE(Moment::FromKey(m2.key()) == m2);
+    REQUIRE(Moment::FromKey(m3.key()) == m3);
+    REQUIRE(Moment::FromKey(m4.key()) == m4);
+}
+
+TEST_CASE("MomentMap overall", "[momentmap, timeplane_all]") {
+    MomentMap<std::string> map{};
+    REQUIRE(map.empty());
+    REQUIRE(map.Find(Moment{0, 0}) == nullptr);
+    REQUIRE_THROWS_AS(map.at(Moment(0, 0)), std::out_of_range);
+
+    // Enough entries to cause several reallocations and long probes
+    for (int timeline = 0; timeline < 10; timeline++) {
+        for (int time = 0; time < 100; time++) {
+            REQUIRE(map.emplace(Moment{timeline, time},
+                                std::to_string(timeline * 1000 + time)));
+        }
+    }
+    REQUIRE(map.size() == 1000);
+    REQUIRE(map.capacity() >= 1000);
+    REQUIRE(!map.emplace(Moment{3, 4}, "duplicate"));
+    REQUIRE(map.at(Moment{3, 4}) == "3004");
+    REQUIRE(*map.Find(Moment{9, 99}) == "9099");
+    REQUIRE(map.count(Moment{0, 0}) == 1);
+    REQUIRE(map.count(Moment{10, 0}) == 0);
+    REQUIRE(map.count(Moment{0, 100}) == 0);
+
+    map.at(Moment{5, 5}) = "modified";
+    REQUIRE(map.at(Moment{5, 5}) == "modified");
+
+    SECTION("Erasing single entries") {
+        REQUIRE(map.erase(Moment{5, 4}) == 1);
+        REQUIRE(map.erase(Moment{5, 4}) == 0);
+        REQUIRE(map.size() == 999);
+        map.at(Moment{5, 5}) = "5005";
+        for (int timeline = 0; timeline < 10; timeline++) {
+            for (int time = 0; time < 100; time += 2) {
+                map.erase(Moment{timeline, time});
+            }
+        }
+        REQUIRE(map.size() == 500);
+        for (int timeline = 0; timeline < 10; timeline++) {
+            for (int time = 1; time < 100; time += 2) {
+                REQUIRE(map.at(Moment(timeline, time)) == std::to_string(
+                            timeline * 1000 + time));
+            }
+        }
+    }
+
+    SECTION("Erasing a range of entries") {
+        MomentStore store{};
+        for (int time = 50; time < 150; time++) {
+            store.push_back(Moment{7, time});
+        }
+        REQUIRE(map.erase(std::make_pair(store.cbegin(), store.cend())) == 50);
+        REQUIRE(map.size() == 950);
+        REQUIRE(map.count(Moment{7, 49}) == 1);
+        REQUIRE(map.count(Moment{7, 50}) == 0);
+        REQUIRE(map.count(Moment{7, 99}) == 0);
+
+        int visited = 0;
+        map.ForEach([&visited] (Moment m, std::string const& value) {
+            if (!(m == Moment{5, 5})) {
+                REQUIRE(value == std::to_string(
+                            m.parent_timeline_num() * 1000 + m.time()));
+            }
+            visited++;
+        });
+        REQUIRE(visited == 950);
+    }
+
+    SECTION("Reclaiming retired moments") {
+        RetirementLog log{};
+        log.Retire(7, 95, 100);
+        log.Retire(8, 90, 120);
+        REQUIRE(log.epoch() == 2);
+        REQUIRE(log.RetiredSince(0) == 35);
+        REQUIRE(map.Reclaim(log, 0) == 15);
+        REQUIRE(map.count(Moment{7, 94}) == 1);
+        REQUIRE(map.count(Moment{7, 95}) == 0);
+        REQUIRE(map.count(Moment{8, 90}) == 0);
+        REQUIRE(map.Reclaim(log, 2) == 0);
+
+        // Enough retirements to sweep every entry at once
+        int capacity = map.capacity();
+        for (int timeline = 0; timeline < 7; timeline++) {
+            log.Retire(timeline, 10, 100);
+        }
+        log.Retire(7, 10, 95);
+        log.Retire(8, 10, 90);
+        REQUIRE(map.Reclaim(log, 2) == 7 * 90 + 85 + 80);
+        REQUIRE(map.size() == 190);
+        REQUIRE(map.capacity() < capacity);
+        REQUIRE(map.at(Moment{9, 50}) == "9050");
+        REQUIRE(map.at(Moment{3, 9}) == "3009");
+        REQUIRE(map.count(Moment{3, 10}) == 0);
+        REQUIRE(map.count(Moment{7, 95}) == 0);
+    }
+
+    SECTION("Moving and clearing") {
+        MomentMap<std::string> other{std::move(map)};
+        REQUIRE(map.empty());
+        REQUIRE(other.size() == 1000);
+        other.clear();
+        REQUIRE(other.empty());
+        REQUIRE(other.Find(Moment{3, 4}) == nullptr);
+        REQUIRE(other.emplace(Moment{3, 4}, "again"));
+        REQUIRE(other.at(Moment{3, 4}) == "again");
+    }
+}
+
+TEST_CASE("TieredMomentMap overall", "[momentmap, timeplane_all]") {
+    SpillFile file{};
+    TieredMomentMap<std::string> map{};
+    for (int timeline = 0; timeline < 3; timeline++) {
+        for (int time = 0; time < 20; time++) {
+            map.emplace(Moment{timeline, time},
+                        std::to_string(timeline * 100 + time));
+        }
+    }
+    REQUIRE(map.Spill(file, 15) == 45);
+    REQUIRE(map.size() == 60);
+    REQUIRE(map.num_spilled() == 45);
+    REQUIRE(file.size() > 0);
+
+    SECTION("Spilled values are read back") {
+        REQUIRE(map.at(Moment{1, 3}) == "103");
+        REQUIRE(map.at(Moment{2, 17}) == "217");
+        REQUIRE(map.count(Moment{0, 0}) == 1);
+        REQUIRE(map.Find(Moment{3, 0}) == nullptr);
+        REQUIRE_THROWS_AS(map.at(Moment{0, 20}), std::out_of_range);
+        // Values read back stay in place until the next spill
+        REQUIRE(map.Find(Moment{1, 3}) == map.Find(Moment{1, 3}));
+        REQUIRE_FALSE(map.emplace(Moment{1, 3}, "replaced"));
+        REQUIRE(map.at(Moment{1, 3}) == "103");
+    }
+
+    SECTION("Spilling again") {
+        long file_size = file.size();
+        REQUIRE(map.Spill(file, 15) == 0);
+        REQUIRE(file.size() == file_size);
+        REQUIRE(map.Spill(file, 18) == 9);
+        REQUIRE(map.num_spilled() == 54);
+        REQUIRE(map.at(Moment{0, 17}) == "17");
+    }
+
+    SECTION("Erasing spilled values") {
+        REQUIRE(map.at(Moment{1, 3}) == "103");
+        REQUIRE(map.erase(Moment{1, 3}) == 1);
+        REQUIRE(map.erase(Moment{1, 17}) == 1);
+        REQUIRE(map.erase(Moment{1, 3}) == 0);
+        REQUIRE(map.Find(Moment{1, 3}) == nullptr);
+        REQUIRE(map.size() == 58);
+        REQUIRE(map.num_spilled() == 44);
+
+        RetirementLog log{};
+        log.Retire(2, 10, 20);
+        REQUIRE(map.at(Moment{2, 12}) == "212");
+        REQUIRE(map.Reclaim(log, 0) == 10);
+        REQUIRE(map.count(Moment{2, 12}) == 0);
+        REQUIRE(map.count(Moment{2, 18}) == 0);
+        REQUIRE(map.at(Moment{2, 9}) == "209");
+        REQUIRE(map.num_spilled() == 39);
+    }
+}
+
+TEST_CASE("SharedMomentMap overall", "[momentmap, timeplane_all]") {
+    using Map = SharedMomentMap<int>;
+    int constexpr kLength = Map::kChunkSize + 5;
+    Map map{};
+    for (int time = 0; time < kLength; time++) {
+        map.Append(Moment{0, time}, std::make_shared<int const>(time));
+    }
+    map.Append(Moment{1, 10}, std::make_shared<int const>(110));
+    REQUIRE(map.size() == kLength + 1);
+    REQUIRE(*map.Find(Moment{0, 3}) == 3);
+    REQUIRE(*map.Find(Moment{0, kLength - 1}) == kLength - 1);
+    REQUIRE(*map.Find(Moment{1, 10}) == 110);
+    REQUIRE(map.Find(Moment{0, kLength}) == nullptr);
+    REQUIRE(map.Find(Moment{1, 9}) == nullptr);
+    REQUIRE(map.Find(Moment{2, 0}) == nullptr);
+    REQUIRE_THROWS_AS(map.Append(Moment{1, 12},
+                                 std::make_shared<int const>(0)),
+                      std::invalid_argument);
+
+    // Copies share values, but do not see later changes
+    Map copy{map};
+    map.Append(Moment{0, kLength}, std::make_shared<int const>(kLength));
+    REQUIRE(copy.Find(Moment{0, 3}) == map.Find(Moment{0, 3}));
+    REQUIRE(copy.Find(Moment{0, kLength}) == nullptr);
+    REQUIRE(*map.Find(Moment{0, kLength}) == kLength);
+
+    RetirementLog log{};
+    log.Retire(0, 3, kLength + 1);
+    REQUIRE(map.Reclaim(log, 0) == kLength - 2);
+    REQUIRE(map.size() == 4);
+    REQUIRE(map.Find(Moment{0, 3}) == nullptr);
+    REQUIRE(*map.Find(Moment{0, 2}) == 2);
+    REQUIRE(*copy.Find(Moment{0, 3}) == 3);
+    map.Append(Moment{0, 3}, std::make_shared<int const>(-3));
+    REQUIRE(*map.Find(Moment{0, 3}) == -3);
+    REQUIRE(*copy.Find(Moment{0, 3}) == 3);
+
+    // Either of two instances holding the same values may grow them
+    Map other{copy};
+    copy.Append(Moment{0, kLength}, std::make_shared<int const>(1));
+    other.Append(Moment{0, kLength}, std::make_shared<int const>(2));
+    for (int time = kLength + 1; time < 3 * Map::kChunkSize; time++) {
+        other.Append(Moment{0, time}, std::make_shared<int const>(time));
+    }
+    REQUIRE(*copy.Find(Moment{0, kLength}) == 1);
+    REQUIRE(*other.Find(Moment{0, kLength}) == 2);
+    REQUIRE(copy.Find(Moment{0, kLength + 1}) == nullptr);
+    REQUIRE(other.Find(Moment{0, 3}) == copy.Find(Moment{0, 3}));
+    REQUIRE(*other.Find(Moment{0, 3 * Map::kChunkSize - 1}) ==
+            3 * Map::kChunkSize - 1);
+
+    // Spilled values are read back, while earlier copies keep theirs
+    auto file = std::make_shared<SpillFile>();
+    Map before_spill{other};
+    // The first moments of timeline 0 and the only one of timeline 1
+    int const num_spilled = Map::kChunkSize + 3 + 1;
+    REQUIRE(other.Spill(file, Map::kChunkSize + 3) == num_spilled);
+    REQUIRE(other.Spill(file, Map::kChunkSize + 3) == 0);
+    REQUIRE(other.num_spilled() == num_spilled);
+    REQUIRE(other.usage().num_spilled == num_spilled);
+    REQUIRE(*other.Find(Moment{1, 10}) == 110);
+    REQUIRE(other.usage().bytes < before_spill.usage().bytes);
+    for (int time = 0; time < 3 * Map::kChunkSize; time++) {
+        REQUIRE(other.count(Moment{0, time}) == 1);
+        REQUIRE(*other.Find(Moment{0, time}) ==
+                *before_spill.Find(Moment{0, time}));
+    }
+    REQUIRE(before_spill.Find(Moment{0, 3}) == copy.Find(Moment{0, 3}));
+    REQUIRE(other.Find(Moment{0, 3}) != copy.Find(Moment{0, 3}));
+    Map after_spill{other};
+    other.Append(Moment{0, 3 * Map::kChunkSize},
+                 std::make_shared<int const>(0));
+    REQUIRE(*after_spill.Find(Moment{0, 1}) == 1);
+    REQUIRE(after_spill.count(Moment{0, 3 * Map::kChunkSize}) == 0);
+
+    // Sharing keeps only the listed timelines
+    Map shared = map.Share({1, 1, 4});
+    REQUIRE(shared.size() == 1);
+    REQUIRE(shared.Find(Moment{1, 10}) == map.Find(Moment{1, 10}));
+    REQUIRE(shared.count(Moment{0, 2}) == 0);
+    REQUIRE_THROWS_AS(shared.at(Moment{0, 2}), std::out_of_range);
+}
+
+TEST_CASE("MomentStore overall", "[momentstore, timeplane_all]") {
+    int constexpr kBlockSize = MomentStore::kBlockSize;
+    MomentStore store{};
+    REQUIRE(store.empty());
+    REQUIRE(store.num_blocks() == 0);
+    REQUIRE(store.cbegin() == store.cend());
+
+    for (int i = 0; i < 3 * kBlockSize; i++) {
+        store.push_back(Moment{1, i});
+    }
+    Moment const* first = &store[0];
+    Moment const* last = &store.back();
+    for (int i = 3 * kBlockSize; i < 5 * kBlockSize; i++) {
+        store.push_back(Moment{1, i});
+    }
+
+    REQUIRE(store.size() == 5 * kBlockSize);
+    REQUIRE(store.num_blocks() == 5);
+    // Adding moments never relocates existing moments
+    REQUIRE(first == &store[0]);
+    REQUIRE(last == &store[3 * kBlockSize - 1]);
+    REQUIRE(store.at(kBlockSize) == Moment(1, kBlockSize));
+    REQUIRE(store.back() == Moment(1, 5 * kBlockSize - 1));
+    REQUIRE_THROWS_AS(store.at(-1), std::out_of_range);
+    REQUIRE_THROWS_AS(store.at(5 * kBlockSize), std::out_of_range);
+
+    int expected_time = 0;
+    for (Moment m: store) {
+        REQUIRE(m == Moment(1, expected_time));
+        expected_time++;
+    }
+    REQUIRE(store.cend() - store.cbegin() == 5 * kBlockSize);
+    REQUIRE((store.cbegin() + kBlockSize)->time() == kBlockSize);
+    REQUIRE(store.cbegin()[2 * kBlockSize + 1].time() == 2 * kBlockSize + 1);
+
+    SECTION("Erasing within a block") {
+        store.EraseFrom(2 * kBlockSize + 1);
+        REQUIRE(store.size() == 2 * kBlockSize + 1);
+        REQUIRE(store.num_blocks() == 3);
+        REQUIRE(first == &store[0]);
+        REQUIRE(store.back() == Moment(1, 2 * kBlockSize));
+
+        store.push_back(Moment{2, 0});
+        REQUIRE(store.back() == Moment(2, 0));
+        REQUIRE(store.num_blocks() == 3);
+    }
+
+    SECTION("Erasing at a block boundary") {
+        store.EraseFrom(kBlockSize);
+        REQUIRE(store.size() == kBlockSize);
+        REQUIRE(store.num_blocks() == 1);
+        REQUIRE(first == &store[0]);
+
+        store.EraseFrom(0);
+        REQUIRE(store.empty());
+        REQUIRE(store.num_blocks() == 0);
+    }
+}
+
+TEST_CASE("BlockArena overall", "[blockarena, timeplane_all]") {
+    BlockArena arena{20, 4};
+    REQUIRE(arena.block_size() >= 20);
+    REQUIRE(arena.block_size() % alignof(std::max_align_t) == 0);
+    REQUIRE(arena.num_chunks() == 0);
+
+    std::vector<void*> blocks;
+    for (int i = 0; i < 6; i++) {
+        blocks.push_back(arena.Allocate());
+    }
+    REQUIRE(arena.num_allocated() == 6);
+    REQUIRE(arena.num_chunks() == 2);
+    for (int i = 1; i < 4; i++) {
+        REQUIRE(static_cast<char*>(blocks[i]) - static_cast<char*>(
+                    blocks[i - 1]) == static_cast<int>(arena.block_size()));
+    }
+
+    // Freed blocks are handed out again before any new chunk
+    arena.Deallocate(blocks[2]);
+    arena.Deallocate(blocks[4]);
+    REQUIRE(arena.num_allocated() == 4);
+    REQUIRE(arena.Allocate() == blocks[4]);
+    REQUIRE(arena.Allocate() == blocks[2]);
+    arena.Allocate();
+    arena.Allocate();
+    REQUIRE(arena.num_chunks() == 2);
+    arena.Allocate();
+    REQUIRE(arena.num_chunks() == 3);
+    REQUIRE(arena.num_allocated() == 9);
+}
+
 TEST_CASE("TimeLine default construction", "[timeline, timeplane_all]") {
     TimeLine t0{};
     Moment m = t0.GetMoment(0);
@@ -142,6 +503,116 @@ TEST_CASE("TimeLine branching", "[timeline, timeplane_all]") {
     REQUIRE_THROWS_AS(TimeLine(t1, 3), std::invalid_argument);
     REQUIRE_THROWS_AS(TimeLine(t2, 3), std::invalid_argument);
     REQUIRE_THROWS_AS(TimeLine(t3, 2), std::invalid_argument);
+
+    SECTION("Listing segments") {
+        std::vector<TimeLine::Segment> segments = t4.Segments();
+        REQUIRE(segments.size() == 5);
+        int branch_times[] = {0, 2, 3, 2, 0};
+        int num_moments[] = {1, 1, 1, 2, 3};
+        for (int i = 0; i < 5; i++) {
+            REQUIRE(segments[i].timeline_num == 4 - i);
+            REQUIRE(segments[i].branch_time == branch_times[i]);
+            REQUIRE(segments[i].num_moments == num_moments[i]);
+        }
+        REQUIRE(t4.Segments(2).size() == 2);
+        REQUIRE(t1.Segments().size() == 2);
+        REQUIRE(t1.Segments(1).empty());
+    }
+
+    SECTION("Accessing ranges of moments") {
+        std::vector<TimeLine::Span> spans = t2.GetMoments(0, 4);
+        REQUIRE(spans.size() == 3);
+        int timeline_nums[] = {0, 1, 2};
+        int begin_times[] = {0, 2, 3};
+        int end_times[] = {2, 3, 4};
+        for (int i = 0; i < 3; i++) {
+            REQUIRE(spans[i].timeline_num == timeline_nums[i]);
+            REQUIRE(spans[i].begin_time == begin_times[i]);
+            REQUIRE(spans[i].end_time == end_times[i]);
+        }
+        REQUIRE(spans[1][2] == m2b);
+
+        spans = t3.GetMoments(1, 3);
+        REQUIRE(spans.size() == 2);
+        REQUIRE(spans[0].timeline_num == 0);
+        REQUIRE(spans[0].size() == 1);
+        REQUIRE(spans[1][2] == m2c);
+        REQUIRE(t4.GetMoments(0, 1).size() == 1);
+        REQUIRE(t1.GetMoments(3, 4)[0][3] == m3a);
+        REQUIRE(t1.GetMoments(2, 2).empty());
+
+        REQUIRE_THROWS_AS(t1.GetMoments(-1, 2), std::out_of_range);
+        REQUIRE_THROWS_AS(t1.GetMoments(2, 5), std::out_of_range);
+        REQUIRE_THROWS_AS(t1.GetMoments(3, 2), std::out_of_range);
+    }
+}
+
+TEST_CASE("TimeLine lookup across many branches",
+          "[timeline, timeplane_all]") {
+    using TimeLinePtr = std::unique_ptr<TimeLine>;
+    TimeLinePtr t0 = std::make_unique<TimeLine>();
+    TimeLinePtr tn = std::make_unique<TimeLine>(*t0, 0);
+    for (int i = 1; i <= 1000; i++) {
+        tn->MakeMoment();
+        tn->MakeMoment();
+        tn.reset(new TimeLine{*tn, 2 * i});
+    }
+    t0.reset(nullptr);
+    // o
+    // o o x
+    //     o o x
+    //         ...
+    //             o
+
+    for (int i = 0; i < 2000; i++) {
+        Moment m = tn->GetMoment(i);
+        REQUIRE(m.time() == i);
+        REQUIRE(m.parent_timeline_num() == i / 2 + 1);
+    }
+    REQUIRE(tn->GetMoment(2000) == tn->LatestMoment());
+    REQUIRE(tn->LatestMoment().parent_timeline_num() == 1001);
+    REQUIRE_THROWS_AS(tn->GetMoment(-1), std::out_of_range);
+    REQUIRE_THROWS_AS(tn->GetMoment(2001), std::out_of_range);
+
+    // The spans agree with single lookups, before and after compacting
+    for (int compacted = 0; compacted < 2; compacted++) {
+        std::vector<TimeLine::Span> spans = tn->GetMoments(501, 2001);
+        REQUIRE(spans.size() == 751);
+        int time = 501;
+        for (TimeLine::Span const& span: spans) {
+            REQUIRE(span.begin_time == time);
+            for (; time < span.end_time; time++) {
+                REQUIRE(span[time] == tn->GetMoment(time));
+            }
+        }
+        REQUIRE(time == 2001);
+        tn->CompactIndex();
+    }
+}
+
+TEST_CASE("TimeLine allocated from an arena", "[timeline, timeplane_all]") {
+    BlockArena arena{TimeLine::arena_block_size()};
+    {
+        TimeLine t0{MomentDeleterFn{}, &arena};
+        t0.MakeMoment();
+        t0.MakeMoment();
+        REQUIRE(arena.num_allocated() == 1);
+
+        std::unique_ptr<TimeLine> t1 = std::make_unique<TimeLine>(t0, 1);
+        REQUIRE(arena.num_allocated() == 2);
+        REQUIRE_THROWS_AS(TimeLine(t0, 2), std::invalid_argument);
+        REQUIRE_THROWS_AS(TimeLine(*t1, 5), std::out_of_range);
+        REQUIRE(arena.num_allocated() == 2);
+
+        // The branch is kept alive by the timeline to its right
+        TimeLine t2{*t1, 1};
+        t1.reset();
+        REQUIRE(arena.num_allocated() == 3);
+        REQUIRE(t2.GetMoment(0) == Moment(0, 0));
+        REQUIRE(t2.LatestMoment() == Moment(2, 1));
+    }
+    REQUIRE(arena.num_allocated() == 0);
+    REQUIRE(arena.num_chunks() == 1);
 }
 
 TEST_CASE("TimeLine moment deletion", "[timeline, timeplane_all]") {
@@ -560,49 +1031,89 @@ TEST_CASE("TimePlane basic functionality", "[timeplane, timeplane_all]") {
         REQUIRE(m2.time() == 1);
         REQUIRE(tp.latest_antitelephone_arrival() == 2);
     }
+
+    // The moment at time 2 of the first timeline is no longer reachable
+    std::vector<TimeLine::Segment> segments = tp.Segments();
+    REQUIRE(segments.size() == 3);
+    REQUIRE(segments[0].num_moments == 1);
+    REQUIRE(segments[1].num_moments == 1);
+    REQUIRE(segments[2].num_moments == 2);
+
+    // Both arrivals are indexed, the latter by the player who travelled
+    tp.rightmost_timeline().MakeMoment();
+    tp.MakeNewTimeLine(1, 4);
+    ArrivalIndex const& arrivals = tp.arrivals();
+    REQUIRE(arrivals.size() == 3);
+    auto range = arrivals.Range(1, 2);
+    REQUIRE(range.second - range.first == 2);
+    REQUIRE(range.first->timeline_num == 2);
+    REQUIRE(range.first->source == Moment{1, 2});
+    REQUIRE(range.first->traveller == ArrivalIndex::kUnknownTraveller);
+    REQUIRE((range.first + 1)->timeline_num == 3);
+    REQUIRE((range.first + 1)->source == Moment{2, 2});
+    REQUIRE((range.first + 1)->traveller == 4);
+    REQUIRE(tp.latest_antitelephone_arrival() == 2);
+}
+
+TEST_CASE("ArrivalIndex overall", "[arrivalindex, timeplane_all]") {
+    using Arrival = ArrivalIndex::Arrival;
+    ArrivalIndex index{};
+    REQUIRE(index.empty());
+    REQUIRE_THROWS_AS(index.latest_branch_time(), std::out_of_range);
+    REQUIRE(index.Range(0, 10).first == index.end());
+
+    index.Add(Arrival{5, Moment{0, 9}, 0, 1});
+    index.Add(Arrival{2, Moment{1, 7}, 1, 2});
+    index.Add(Arrival{5, Moment{2, 6}, 0, 3});
+    index.Add(Arrival{8, Moment{3, 9}, 2, 4});
+    REQUIRE(index.size() == 4);
+    REQUIRE(index.latest_branch_time() == 8);
+
+    std::vector<int> timelines{};
+    for (Arrival const& arrival: index) {
+        timelines.push_back(arrival.timeline_num);
+    }
+    REQUIRE(timelines == std::vector<int>{2, 1, 3, 4});
+
+    auto range = index.Range(3, 8);
+    REQUIRE(range.second - range.first == 2);
+    REQUIRE(range.first->timeline_num == 1);
+    REQUIRE((range.first + 1)->timeline_num == 3);
+    range = index.Range(2, 3);
+    REQUIRE(range.second - range.first == 1);
+    REQUIRE(range.first->source == Moment{1, 7});
+    REQUIRE(index.Range(6, 8).first == index.Range(6, 8).second);
+    REQUIRE(index.Range(9, 4).first == index.end());
+    REQUIRE(index.Range(4, 0).first == index.Range(4, 0).second);
 }
 
 TEST_CASE("TimePlane moment deletion", "[timeplane, timeplane_all]") {
     TimePlane tp{};
-    std::unordered_set<Moment> items0;
-    std::unordered_set<Moment> items1;
-    MomentDeleterFn deleter0 =
-    [&items0] (MomentIterators iterators) {
-        std::for_each(iterators.first, iterators.second,
-        [&items0] (Moment m) {
-            items0.erase(m);
-        });
-    };
-
-    MomentDeleterFn deleter1 =
-    [&items1] (MomentIterators iterators) {
-        std::for_each(iterators.first, iterators.second,
-        [&items1] (Moment m) {
-            items1.erase(m);
-        });
-    };
-
-    tp.RegisterMomentDeleter(deleter0);
-    tp.RegisterMomentDeleter(deleter1);
+    RetirementLog const& log = tp.retirements();
+    MomentMap<int> items0{};
+    MomentMap<int> items1{};
+    int epoch = log.epoch();
+    REQUIRE(epoch == 0);
 
     {
         TimeLine& t0 = tp.rightmost_timeline();
-        items0.insert(t0.LatestMoment());
-        items1.insert(t0.MakeMoment());
-        items0.insert(t0.MakeMoment());
-        items1.insert(t0.MakeMoment());
-        items0.insert(t0.MakeMoment());
-        items1.insert(t0.MakeMoment());
+        items0.emplace(t0.LatestMoment(), 0);
+        items1.emplace(t0.MakeMoment(), 1);
+        items0.emplace(t0.MakeMoment(), 2);
+        items1.emplace(t0.MakeMoment(), 3);
+        items0.emplace(t0.MakeMoment(), 4);
+        items1.emplace(t0.MakeMoment(), 5);
         REQUIRE(t0.LatestMoment().time() == 5);
     }
 
     tp.MakeNewTimeLine(3);
+    REQUIRE(log.epoch() == epoch);
 
     {
         TimeLine& t1 = tp.rightmost_timeline();
-        items0.insert(t1.LatestMoment());
-        items1.insert(t1.MakeMoment());
-        items0.insert(t1.MakeMoment());
+        items0.emplace(t1.LatestMoment(), 3);
+        items1.emplace(t1.MakeMoment(), 4);
+        items0.emplace(t1.MakeMoment(), 5);
         REQUIRE(t1.LatestMoment().time() == 5);
     }
 
@@ -613,13 +1124,116 @@ TEST_CASE("TimePlane moment deletion", "[timeplane, timeplane_all]") {
 
     tp.MakeNewTimeLine(5);
     TimeLine& t2 = tp.rightmost_timeline();
-    items1.insert(t2.LatestMoment());
+    items1.emplace(t2.LatestMoment(), 5);
+
+    // The moments after the first branch are retired together
+    REQUIRE(log.epoch() == epoch + 1);
+    REQUIRE(log.RetiredSince(epoch) == 3);
+    REQUIRE(log.at(epoch).timeline_num == 0);
+    REQUIRE(log.at(epoch).begin_time == 3);
+    REQUIRE(log.at(epoch).end_time == 6);
+    REQUIRE(log.IsRetired(Moment{0, 3}));
+    REQUIRE(!log.IsRetired(Moment{0, 2}));
+    REQUIRE(!log.IsRetired(Moment{1, 5}));
+    REQUIRE_THROWS_AS(log.at(epoch + 1), std::out_of_range);
 
     // 010xxx
     //    010
     //      1
+    REQUIRE(items0.Reclaim(log, epoch) == 1);
+    REQUIRE(items1.Reclaim(log, epoch) == 2);
     REQUIRE(items0.size() == 4);
     REQUIRE(items1.size() == 3);
+    REQUIRE(items0.count(Moment{0, 4}) == 0);
+    REQUIRE(items1.at(Moment{0, 1}) == 1);
+    REQUIRE(items1.at(Moment{2, 5}) == 5);
+    REQUIRE(items1.Reclaim(log, log.epoch()) == 0);
+
+    SECTION("Clean up can be deferred") {
+        TimePlane deferred{false, true};
+        REQUIRE(deferred.defers_cleanup());
+        for (int i = 0; i < 5; i++) {
+            deferred.rightmost_timeline().MakeMoment();
+        }
+        deferred.MakeNewTimeLine(3).MakeMoment();
+        deferred.MakeNewTimeLine(4);
+        REQUIRE(deferred.num_discarded() == 1);
+        REQUIRE(deferred.retirements().epoch() == 0);
+
+        // Discarded moments are inaccessible before being retired
+        REQUIRE(!deferred.IsAccessible(Moment{0, 4}));
+        REQUIRE(deferred.IsAccessible(Moment{0, 2}));
+        REQUIRE(deferred.IsAccessible(Moment{1, 3}));
+        REQUIRE(deferred.IsAccessible(Moment{2, 4}));
+        REQUIRE(!deferred.IsAccessible(Moment{2, 5}));
+        REQUIRE(!deferred.IsAccessible(Moment{3, 0}));
+
+        deferred.CollectDiscarded();
+        REQUIRE(deferred.num_discarded() == 0);
+        REQUIRE(deferred.retirements().RetiredSince(0) == 3);
+        REQUIRE(deferred.retirements().IsRetired(Moment{0, 4}));
+        REQUIRE(!deferred.retirements().IsRetired(Moment{0, 2}));
+    }
+
+    SECTION("Moments shared with the right are not retired") {
+        std::unique_ptr<TimePlane> other = std::make_unique<TimePlane>();
+        other->rightmost_timeline().MakeMoment();
+        other->MakeNewTimeLine(1);
+        RetirementLog const& other_log = other->retirements();
+        REQUIRE(other_log.epoch() == 0);
+        other->MakeNewTimeLine(0);
+        REQUIRE(other_log.RetiredSince(0) == 1);
+        REQUIRE(other_log.IsRetired(Moment{0, 1}));
+        REQUIRE(!other_log.IsRetired(Moment{0, 0}));
+    }
 }
 
+TEST_CASE("TimePlane retaining all timelines", "[timeplane, timeplane_all]") {
+    TimePlane tp{true};
+
+    REQUIRE(tp.retains_all_timelines());
+    tp.rightmost_timeline().LatestMoment();
+    for (int i = 0; i < 5; i++) {
+        tp.rightmost_timeline().MakeMoment();
+    }
+    for (int branch_time: {3, 4, 1, 2}) {
+        TimeLine& t = tp.MakeNewTimeLine(branch_time);
+        t.MakeMoment();
+    }
 
+    // 012345
+    //    34
+    //     45
+    //  12
+    //   23
+    REQUIRE(tp.num_timelines() == 5);
+    REQUIRE(tp.retirements().epoch() == 0);
+
+    REQUIRE(tp.GetMoment(0, 5) == Moment(0, 5));
+    REQUIRE(tp.GetMoment(1, 2) == Moment(0, 2));
+    REQUIRE(tp.GetMoment(1, 4) == Moment(1, 4));
+    REQUIRE(tp.GetMoment(2, 3) == Moment(1, 3));
+    REQUIRE(tp.GetMoment(2, 5) == Moment(2, 5));
+    REQUIRE(tp.GetMoment(3, 0) == Moment(0, 0));
+    REQUIRE(tp.GetMoment(3, 2) == Moment(3, 2));
+    REQUIRE(tp.GetMoment(4, 1) == Moment(3, 1));
+    REQUIRE(tp.GetMoment(4, 3) == Moment(4, 3));
+    REQUIRE(tp.GetTimeLine(2).LatestMoment() == Moment(2, 5));
+
+    REQUIRE_THROWS_AS(tp.GetMoment(0, 6), std::out_of_range);
+    REQUIRE_THROWS_AS(tp.GetMoment(1, 6), std::out_of_range);
+    REQUIRE_THROWS_AS(tp.GetMoment(-1, 0), std::out_of_range);
+    REQUIRE_THROWS_AS(tp.GetMoment(5, 0), std::out_of_range);
+
+    SECTION("Only the two rightmost timelines are kept by default") {
+        TimePlane tp_default{};
+        REQUIRE(!tp_default.retains_all_timelines());
+        tp_default.rightmost_timeline().MakeMoment();
+        tp_default.MakeNewTimeLine(1);
+        tp_default.MakeNewTimeLine(0);
+        REQUIRE(tp_default.num_timelines() == 3);
+        REQUIRE(tp_default.GetMoment(1, 1) == Moment(1, 1));
+        REQUIRE(tp_default.GetMoment(2, 0) == Moment(2, 0));
+        REQUIRE_THROWS_AS(tp_default.GetMoment(0, 0), std::out_of_range);
+    }
+}